@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "app_event.h"
+#include <zephyr/posix/sys/eventfd.h>
+#include <zephyr/sys/atomic.h>
+
+K_MSGQ_DEFINE(app_command_queue, sizeof(enum app_command),
+              CONFIG_APP_COMMAND_QUEUE_SIZE, 4);
+
+static atomic_t app_events;
+static int app_event_doorbell = -1;
+
+/** Create the doorbell; call before anything may raise an event */
+int app_event_init(void)
+{
+    app_event_doorbell = eventfd(0, EFD_NONBLOCK);
+
+    return (app_event_doorbell < 0) ? -errno : 0;
+}
+
+/** The descriptor to add to the main loop's poll set (POLLIN) */
+int app_event_fd(void)
+{
+    return app_event_doorbell;
+}
+
+void app_event_raise(uint32_t events)
+{
+    atomic_or(&app_events, events);
+
+    if (app_event_doorbell >= 0)
+    {
+        eventfd_write(app_event_doorbell, 1);
+    }
+}
+
+/** Consume the doorbell and return the events raised since last time */
+uint32_t app_event_take(void)
+{
+    eventfd_t count;
+
+    /* Clear the doorbell before the bits, so no raise can slip between */
+    (void)eventfd_read(app_event_doorbell, &count);
+
+    return atomic_clear(&app_events);
+}
+
+/** Queue a command for the main loop; -ENOMEM if the queue is full */
+int app_command_post(enum app_command cmd)
+{
+    if (k_msgq_put(&app_command_queue, &cmd, K_NO_WAIT) != 0)
+    {
+        return -ENOMEM;
+    }
+
+    app_event_raise(APP_EVENT_COMMAND);
+
+    return 0;
+}
+
+/** Dequeue the oldest command; -EAGAIN when none is waiting */
+int app_command_get(enum app_command *cmd)
+{
+    return (k_msgq_get(&app_command_queue, cmd, K_NO_WAIT) == 0) ? 0 : -EAGAIN;
+}
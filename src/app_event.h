@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Wake-up sources of the main event loop.
+ *
+ * Other threads raise event bits here, e.g. "a new sample is in the
+ * ring" or "a command was queued". Each raise also rings an eventfd
+ * doorbell. The main loop puts that eventfd in the same zsock_poll()
+ * set as the MQTT socket, so one call waits for samples, commands,
+ * broker traffic and its own deadlines. In between, the CPU stays in
+ * the idle thread, letting tickless idle do its job.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#define APP_EVENT_SAMPLE        BIT(0)  /* Sampler ring has a new record */
+#define APP_EVENT_COMMAND       BIT(1)  /* app_command_post() was called */
+
+enum app_command
+{
+    APP_CMD_FLUSH,              /* Publish everything queued right away */
+    APP_CMD_RECONNECT,          /* Drop and remake the broker connection */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int app_event_init(void);
+int app_event_fd(void);
+void app_event_raise(uint32_t events);
+uint32_t app_event_take(void);
+int app_command_post(enum app_command cmd);
+int app_command_get(enum app_command *cmd);
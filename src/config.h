@@ -5,6 +5,11 @@
  */
 #pragma once
 
+#include "sensor_registry.h"
+#include "latency_stats.h"
+#include "window_stats.h"
+#include "payload_codec.h"
+
 #ifdef CONFIG_NET_CONFIG_SETTINGS
 #ifdef CONFIG_NET_IPV6
 #define ZEPHYR_ADDR     CONFIG_NET_CONFIG_MY_IPV6_ADDR
@@ -43,13 +48,45 @@
 #endif
 
 #define APP_CONNECT_TIMEOUT_MS  2000
-#define APP_SLEEP_MSECS     500
+#define APP_CONNECT_POLL_MS     50
+
+#if defined(CONFIG_MQTT_BATCH)
+/* Room for a worst-case payload_codec batch */
+#define APP_MQTT_RECORD_SIZE    PAYLOAD_CODEC_MAX_SIZE(CONFIG_MQTT_BATCH_SIZE)
+#else
+#define APP_MQTT_RECORD_SIZE    16
+#endif
+
+#if defined(CONFIG_WINDOW_STATS)
+/* Window summaries go out as well, whatever the readings are sent as */
+#define APP_MQTT_PAYLOAD_SIZE   MAX(APP_MQTT_RECORD_SIZE, WINDOW_SUMMARY_SIZE)
+#else
+#define APP_MQTT_PAYLOAD_SIZE   APP_MQTT_RECORD_SIZE
+#endif
+
+#if defined(CONFIG_LATENCY_STATS_PUBLISH)
+/* A latency_format() object, about 100 characters per stage. It goes out
+ * at QoS 0, so it only has to fit the tx buffer, not an in-flight slot.
+ */
+#define APP_MQTT_METRICS_SIZE   (2 + (100 * LATENCY_STAGE_COUNT))
+#else
+#define APP_MQTT_METRICS_SIZE   0
+#endif
 
-#define APP_CONNECT_TRIES   10
+#define APP_MQTT_BUFFER_SIZE                                            \
+    MAX(128, 64 + MAX(APP_MQTT_PAYLOAD_SIZE, APP_MQTT_METRICS_SIZE))
 
-#define APP_MQTT_BUFFER_SIZE    128
+/* Each in-flight QoS 1/2 publish keeps a payload copy for retransmits */
+#define APP_MQTT_INFLIGHT_MAX   CONFIG_MQTT_INFLIGHT_MAX
+#define APP_MQTT_RETRANSMIT_MS  CONFIG_MQTT_RETRANSMIT_MS
 
 #define MQTT_CLIENTID       "zephyr_publisher"
 
-#define NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC1   "/Nuertey/Nucleo/F767ZI/Temperature"
-#define NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC2   "/Nuertey/Nucleo/F767ZI/Humidity"
+/* Every topic comes from the sensor registry node (devicetree) */
+#define NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_BATCH                        \
+    DT_PROP(SENSOR_REGISTRY_NODE, batch_topic)
+#define NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_METRICS                      \
+    DT_PROP(SENSOR_REGISTRY_NODE, metrics_topic)
+
+/* Per-channel QoS comes from the sensor registry; see MQTT_BATCH_QOS */
+#define NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_BATCH_QOS  CONFIG_MQTT_BATCH_QOS
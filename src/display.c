@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "display.h"
+#include "lcd_trend.h"
+#include "sampler.h"
+#include "value_format.h"
+#include <stdio.h>
+
+K_THREAD_STACK_DEFINE(display_stack, CONFIG_LCD_RENDER_STACK_SIZE);
+
+static struct k_thread display_thread;
+
+/* Every panel shows the same readings, each paged to its own size */
+static const struct device *display_lcds[LCD_RENDER_PANELS];
+static size_t display_first[LCD_RENDER_PANELS];  /* Channel on row 0 */
+static size_t display_count;
+
+/* Rolling history of each channel, in hundredths, for the sparklines */
+static struct lcd_trend trend[SENSOR_REGISTRY_COUNT];
+
+/* Last good value of each channel; 'valid' marks those read at least once */
+static struct sample_record shown;
+
+/* Copy a registry unit, showing the UTF-8 degree sign as the CGRAM glyph */
+static void display_unit(char *buf, size_t size, const char *unit)
+{
+    size_t len = 0;
+
+    while ((*unit != '\0') && (len + 1 < size))
+    {
+        if (((uint8_t)unit[0] == 0xC2) && ((uint8_t)unit[1] == 0xB0))
+        {
+            buf[len++] = LCD_TREND_DEGREE_STR[0];
+            unit += 2;
+        }
+        else
+        {
+            buf[len++] = *unit++;
+        }
+    }
+
+    buf[len] = '\0';
+}
+
+/* Queue 'text' followed by a sparkline filling the rest of the row */
+static void show_with_trend(const struct device *lcd, uint8_t row,
+                            const char *text, const struct lcd_trend *trend)
+{
+    char line[LCD_MAX_COLUMNS + 1];
+    size_t columns = pi_lcd_columns(lcd);
+    size_t len = strnlen(text, columns);
+
+    memcpy(line, text, len);
+    line[len] = '\0';
+    if (len + 1 < columns)
+    {
+        line[len] = ' ';
+        lcd_trend_render(trend, &line[len + 1], columns - len - 1);
+    }
+
+    lcd_render_row(lcd, row, line);
+}
+
+/* Draw one reading on one panel, paging when it has fewer rows than
+ * there are channels.
+ */
+static void display_panel(size_t panel, const struct sample_record *record)
+{
+    const struct device *lcd = display_lcds[panel];
+    char lineBuffer[LCD_MAX_COLUMNS + 1];
+    char value[12];
+    char unit[8];
+    size_t rows = MIN(pi_lcd_rows(lcd), SENSOR_REGISTRY_COUNT);
+    size_t first = display_first[panel];
+    size_t c;
+
+    for (size_t row = 0; row < rows; row++)
+    {
+        c = (first + row) % SENSOR_REGISTRY_COUNT;
+
+        if (record->valid & BIT(c))
+        {
+            sensor_value_format(value, sizeof(value), &record->value[c], 2);
+        }
+        else
+        {
+            strcpy(value, "--");
+        }
+        display_unit(unit, sizeof(unit), sensor_registry[c].unit);
+        snprintf(lineBuffer, sizeof(lineBuffer), "%s%s", value, unit);
+
+        show_with_trend(lcd, row, lineBuffer, &trend[c]);
+    }
+    display_first[panel] = (first + rows) % SENSOR_REGISTRY_COUNT;
+}
+
+static void display_loop(void *p1, void *p2, void *p3)
+{
+    struct sampler_reader reader;
+    struct sample_record record;
+    size_t c;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    sampler_reader_init(&reader);
+
+    while (true)
+    {
+        if (sampler_read(&reader, &record, K_FOREVER) != 0)
+        {
+            continue;
+        }
+
+        /* Keep the last good value of a channel on screen across
+         * failed fetches of its sensor.
+         */
+        if (record.valid == 0U)
+        {
+            continue;
+        }
+
+        for (c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+        {
+            if (record.valid & BIT(c))
+            {
+                shown.value[c] = record.value[c];
+                lcd_trend_push(&trend[c], sensor_value_to_centi(&record.value[c]));
+            }
+        }
+        shown.valid |= record.valid;
+
+        for (size_t panel = 0; panel < display_count; panel++)
+        {
+            display_panel(panel, &shown);
+        }
+    }
+}
+
+/** Start following the sampler ring and drawing each reading on every
+ *  one of 'count' panels, which must already have render threads.
+ */
+void display_start(const struct device *const lcds[], size_t count)
+{
+    display_count = MIN(count, ARRAY_SIZE(display_lcds));
+    memcpy(display_lcds, lcds, display_count * sizeof(lcds[0]));
+
+    k_thread_create(&display_thread, display_stack,
+                    K_THREAD_STACK_SIZEOF(display_stack),
+                    display_loop, NULL, NULL, NULL,
+                    CONFIG_LCD_RENDER_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&display_thread, "display");
+}
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Display consumer of the sampler ring.
+ *
+ * Formats every new reading into the LCD rows (value plus sparkline)
+ * from its own low-priority thread, so neither the sampler nor the
+ * network path ever waits on the display.
+ */
+#pragma once
+
+#include "lcd_render.h"
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void display_start(const struct device *const lcds[], size_t count);
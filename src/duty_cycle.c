@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "duty_cycle.h"
+#include "mqtt_publisher.h"
+#include <zephyr/net/net_if.h>
+#include <zephyr/sys/printk.h>
+
+static int64_t duty_cycle_idle_since = -1;  /* -1 while there is work */
+static bool duty_cycle_asleep;
+
+/** Nothing left to send: start, or finish, the linger before sleeping */
+void duty_cycle_idle(struct mqtt_client *client)
+{
+    int64_t now = k_uptime_get();
+
+    if (duty_cycle_asleep)
+    {
+        return;
+    }
+
+    if (duty_cycle_idle_since < 0)
+    {
+        duty_cycle_idle_since = now;
+    }
+
+    if ((now - duty_cycle_idle_since) < CONFIG_APP_DUTY_CYCLE_LINGER_MS)
+    {
+        return;
+    }
+
+    mqtt_conn_suspend(client);
+
+#if defined(CONFIG_NET_POWER_MANAGEMENT)
+    int rc = net_if_suspend(net_if_get_default());
+
+    if ((rc != 0) && (rc != -EALREADY))
+    {
+        printk("Network interface suspend failed: %d\n", rc);
+    }
+#endif
+
+    duty_cycle_asleep = true;
+}
+
+/** Something must go out: wake the interface and the broker link */
+void duty_cycle_busy(void)
+{
+    duty_cycle_idle_since = -1;
+
+    if (!duty_cycle_asleep)
+    {
+        return;
+    }
+
+#if defined(CONFIG_NET_POWER_MANAGEMENT)
+    int rc = net_if_resume(net_if_get_default());
+
+    if ((rc != 0) && (rc != -EALREADY))
+    {
+        printk("Network interface resume failed: %d\n", rc);
+    }
+#endif
+
+    mqtt_conn_resume();
+    duty_cycle_asleep = false;
+}
+
+/** True while the link is parked and the interface suspended */
+bool duty_cycle_is_asleep(void)
+{
+    return duty_cycle_asleep;
+}
+
+/** Milliseconds until the linger ends, or SYS_FOREVER_MS */
+int32_t duty_cycle_next_ms(void)
+{
+    if (duty_cycle_asleep || (duty_cycle_idle_since < 0))
+    {
+        return SYS_FOREVER_MS;
+    }
+
+    return CLAMP(CONFIG_APP_DUTY_CYCLE_LINGER_MS -
+                 (k_uptime_get() - duty_cycle_idle_since),
+                 0, CONFIG_APP_DUTY_CYCLE_LINGER_MS);
+}
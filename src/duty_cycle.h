@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Radio duty cycling between samples.
+ *
+ * Once nothing awaits acknowledgement and nothing is due to go out
+ * within CONFIG_APP_DUTY_CYCLE_LINGER_MS (a batch still filling up does
+ * not count), the broker link lingers for that long, then the MQTT
+ * session is parked (clean_session = 0, so the broker keeps it) and the
+ * network interface suspended. The next publish that falls due resumes
+ * both and reconnects without backoff; the time from that resume to the
+ * first PUBLISH is the "wake" latency stage.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/mqtt.h>
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void duty_cycle_idle(struct mqtt_client *client);
+void duty_cycle_busy(void);
+bool duty_cycle_is_asleep(void);
+int32_t duty_cycle_next_ms(void);
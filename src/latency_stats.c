@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "latency_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const latency_names[LATENCY_STAGE_COUNT] =
+{
+    [LATENCY_FETCH] = "fetch",
+    [LATENCY_FORMAT] = "format",
+    [LATENCY_LCD] = "lcd",
+    [LATENCY_PUBLISH] = "publish",
+    [LATENCY_RTT_QOS1] = "rtt_qos1",
+    [LATENCY_RTT_QOS2] = "rtt_qos2",
+    [LATENCY_WAKE] = "wake",
+};
+
+#if defined(CONFIG_LATENCY_STATS)
+/* Written from the sampler workers, the render thread and main */
+static struct k_spinlock latency_lock;
+static struct latency_hist latency_hists[LATENCY_STAGE_COUNT];
+
+/** Add one 'us' long occurrence of 'stage' */
+void latency_record_us(enum latency_stage stage, uint32_t us)
+{
+    struct latency_hist *hist = &latency_hists[stage];
+    uint32_t b = MIN(find_msb_set(us), LATENCY_BUCKETS - 1);
+    k_spinlock_key_t key;
+
+    key = k_spin_lock(&latency_lock);
+    hist->count++;
+    hist->sum_us += us;
+    hist->max_us = MAX(hist->max_us, us);
+    hist->bucket[b]++;
+    k_spin_unlock(&latency_lock, key);
+}
+
+/** Close a stage opened with latency_start(). The 32-bit counter wraps
+ *  after a few seconds on fast cores, far longer than any stage timed so.
+ */
+void latency_stop(enum latency_stage stage, uint32_t start)
+{
+    latency_record_us(stage, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+}
+#endif
+
+/** Snapshot one histogram; all zero without CONFIG_LATENCY_STATS */
+void latency_get(enum latency_stage stage, struct latency_hist *hist)
+{
+#if defined(CONFIG_LATENCY_STATS)
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+
+    *hist = latency_hists[stage];
+    k_spin_unlock(&latency_lock, key);
+#else
+    ARG_UNUSED(stage);
+    memset(hist, 0, sizeof(*hist));
+#endif
+}
+
+/** Start every histogram afresh */
+void latency_reset(void)
+{
+#if defined(CONFIG_LATENCY_STATS)
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+
+    memset(latency_hists, 0, sizeof(latency_hists));
+    k_spin_unlock(&latency_lock, key);
+#endif
+}
+
+const char *latency_stage_name(enum latency_stage stage)
+{
+    return latency_names[stage];
+}
+
+/** Upper bound of the bucket holding the 'pct' percentile, in
+ *  microseconds; the open last bucket reports the maximum seen.
+ */
+uint32_t latency_percentile_us(const struct latency_hist *hist, uint32_t pct)
+{
+    uint64_t rank = ((uint64_t)hist->count * pct + 99U) / 100U;
+    uint64_t seen = 0;
+    uint32_t b;
+
+    if (hist->count == 0U)
+    {
+        return 0;
+    }
+
+    for (b = 0; b < (LATENCY_BUCKETS - 1); b++)
+    {
+        seen += hist->bucket[b];
+        if (seen >= rank)
+        {
+            return MIN(BIT(b), hist->max_us);
+        }
+    }
+
+    return hist->max_us;
+}
+
+/** Render every stage as one JSON object, e.g. for a metrics topic:
+ *  {"fetch":{"n":12,"mean":25010,"p50":32768,"p99":32768,"max":26011},...}
+ *  in microseconds. Returns the length, or -ENOMEM if 'buf' is too small.
+ */
+int latency_format(char *buf, size_t size)
+{
+    struct latency_hist hist;
+    size_t len = 0;
+    int n;
+
+    n = snprintf(buf, size, "{");
+    for (int s = 0; (n >= 0) && (s < LATENCY_STAGE_COUNT); s++)
+    {
+        len += n;
+        if (len >= size)
+        {
+            return -ENOMEM;
+        }
+
+        latency_get(s, &hist);
+        n = snprintf(&buf[len], size - len,
+                     "%s\"%s\":{\"n\":%u,\"mean\":%u,\"p50\":%u,\"p99\":%u,\"max\":%u}",
+                     (s == 0) ? "" : ",", latency_names[s], hist.count,
+                     (hist.count == 0U) ? 0U : (uint32_t)(hist.sum_us / hist.count),
+                     latency_percentile_us(&hist, 50),
+                     latency_percentile_us(&hist, 99), hist.max_us);
+    }
+
+    len += n;
+    if (len >= size)
+    {
+        return -ENOMEM;
+    }
+
+    n = snprintf(&buf[len], size - len, "}");
+    len += n;
+
+    return (len < size) ? (int)len : -ENOMEM;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Where the time goes: per-stage latency histograms.
+ *
+ * A stage is timed with the cycle counter between latency_start() and
+ * latency_stop() and lands in one of LATENCY_BUCKETS log2 buckets of
+ * microseconds, so recording is a few instructions and memory is fixed.
+ * MQTT round trips are timed in kernel ticks, from the first PUBLISH to
+ * the PUBACK (QoS 1) or PUBCOMP (QoS 2), retransmits included. Without
+ * CONFIG_LATENCY_STATS every call compiles away.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+
+/* Bucket 0 holds < 1 us, bucket b holds [2^(b-1), 2^b) us and the last
+ * one everything from 2^(LATENCY_BUCKETS-2) us (about 4 s) upwards.
+ */
+#define LATENCY_BUCKETS               24
+
+enum latency_stage
+{
+    LATENCY_FETCH,              /* One sensor_sample_fetch() */
+    LATENCY_FORMAT,             /* Readings to console text or payloads */
+    LATENCY_LCD,                /* One render pass over the dirty rows */
+    LATENCY_PUBLISH,            /* mqtt_publish() writing one message */
+    LATENCY_RTT_QOS1,           /* PUBLISH .. PUBACK */
+    LATENCY_RTT_QOS2,           /* PUBLISH .. PUBCOMP */
+    LATENCY_WAKE,               /* mqtt_conn_resume() .. first PUBLISH written */
+    LATENCY_STAGE_COUNT
+};
+
+struct latency_hist
+{
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t bucket[LATENCY_BUCKETS];
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+#if defined(CONFIG_LATENCY_STATS)
+static inline uint32_t latency_start(void)
+{
+    return k_cycle_get_32();
+}
+
+void latency_stop(enum latency_stage stage, uint32_t start);
+void latency_record_us(enum latency_stage stage, uint32_t us);
+#else
+static inline uint32_t latency_start(void)
+{
+    return 0;
+}
+
+static inline void latency_stop(enum latency_stage stage, uint32_t start)
+{
+    ARG_UNUSED(stage);
+    ARG_UNUSED(start);
+}
+
+static inline void latency_record_us(enum latency_stage stage, uint32_t us)
+{
+    ARG_UNUSED(stage);
+    ARG_UNUSED(us);
+}
+#endif
+
+void latency_get(enum latency_stage stage, struct latency_hist *hist);
+void latency_reset(void);
+const char *latency_stage_name(enum latency_stage stage);
+uint32_t latency_percentile_us(const struct latency_hist *hist, uint32_t pct);
+int latency_format(char *buf, size_t size);
@@ -4,309 +4,488 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#define DT_DRV_COMPAT nuertey_lcd16x2
+
 #include "lcd16x2.h"
+#include <zephyr/pm/device.h>
+
+#if defined(CONFIG_LCD16X2_MODEL)
+#include "lcd_model.h"
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#endif
+
+/* Per-instance wiring, resolved from devicetree at build time */
+struct pi_lcd_config
+{
+    struct gpio_dt_spec rs;
+    struct gpio_dt_spec e;
+    struct gpio_dt_spec rw;             /* .port is NULL when grounded */
+    const struct gpio_dt_spec *bus;     /* D4..D7, or D0..D7 in 8-bit mode */
+    uint8_t bus_width;
+    uint8_t columns;
+    uint8_t rows;
+    uint8_t dotsize;                    /* 8 or 10 pixel rows */
+};
 
 struct pi_lcd_data
 {
     uint8_t disp_func;  /* Display Function */
     uint8_t disp_cntl;  /* Display Control */
     uint8_t disp_mode;  /* Display Mode */
-    uint8_t cfg_rows;
-    uint8_t row_offsets[2];
+    uint8_t row_offsets[LCD_MAX_ROWS];
+    uint8_t cursor;     /* Current DDRAM address, LCD_CURSOR_UNKNOWN if lost */
+    char *shadow;       /* rows x columns: what the DDRAM holds right now */
+    char *frame;        /* rows x columns: what the next commit should show */
+    gpio_port_pins_t bus_mask;          /* All data lines in use */
+    gpio_port_value_t bus_lut_hi[16];   /* Nibble -> D4..D7 port value */
+    gpio_port_value_t bus_lut_lo[16];   /* Nibble -> D0..D3 port value */
+    bool bf_ready;      /* Busy flag is readable (interface configured) */
+    uint8_t cgram[LCD_CGRAM_GLYPHS][LCD_GLYPH_ROWS];  /* Uploaded glyphs */
+    uint8_t cgram_valid;    /* Bit per slot whose cgram[] copy is current */
+#if defined(CONFIG_LCD16X2_MODEL)
+    struct lcd_model model; /* Panel simulated from the emulated pins */
+#endif
 };
 
-/* Default Configuration - User can update */
-struct pi_lcd_data lcd_data =
-{
-    .disp_func = LCD_4BIT_MODE | LCD_2_LINE | LCD_5x8_DOTS,
-    .disp_cntl = 0,
-    .disp_mode = 0,
-    .cfg_rows = 0,
-    .row_offsets = {0x00, 0x00}
-};
+#define LCD_CELL(dev, row, col) \
+    (((row) * ((const struct pi_lcd_config *)(dev)->config)->columns) + (col))
 
-void _set_row_offsets(int8_t row0, int8_t row1)
+/* Map a DDRAM address back onto a visible cell; false if off-screen. */
+static bool _pi_lcd_addr_to_cell(const struct device *dev, uint8_t addr,
+                                 uint8_t *col, uint8_t *row)
 {
-    lcd_data.row_offsets[0] = row0;
-    lcd_data.row_offsets[1] = row1;
-}
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+    uint8_t r;
 
-void _pi_lcd_toggle_enable(const struct device *gpio_dev)
-{
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_E, LOW);
-    k_msleep(ENABLE_DELAY);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_E, HIGH);
-    k_msleep(ENABLE_DELAY);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_E, LOW);
-    k_msleep(ENABLE_DELAY);
+    for (r = 0; r < cfg->rows; r++)
+    {
+        if ((addr >= lcd_data->row_offsets[r]) &&
+            (addr < lcd_data->row_offsets[r] + cfg->columns))
+        {
+            *col = addr - lcd_data->row_offsets[r];
+            *row = r;
+            return true;
+        }
+    }
+
+    return false;
 }
 
-void _pi_lcd_4bits_wr(const struct device *gpio_dev, uint8_t bits)
+/* Spin for delays shorter than a tick, otherwise let other threads run */
+static void _pi_lcd_delay_us(uint32_t usec)
 {
-    /* High bits */
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D4, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D5, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D6, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D7, LOW);
-    if ((bits & BIT(4)) == BIT(4))
+    if (usec < k_ticks_to_us_ceil32(1))
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D4, HIGH);
+        k_busy_wait(usec);
     }
-    if ((bits & BIT(5)) == BIT(5))
-    {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D5, HIGH);
-    }
-    if ((bits & BIT(6)) == BIT(6))
-    {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D6, HIGH);
-    }
-    if ((bits & BIT(7)) == BIT(7))
+    else
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D7, HIGH);
+        k_usleep(usec);
     }
+}
 
-    /* Toggle 'Enable' pin */
-    _pi_lcd_toggle_enable(gpio_dev);
+#if defined(CONFIG_LCD16X2_MODEL)
+/* Read RS and the data lines back from the emulator, as the panel would */
+static void _pi_lcd_model_strobe(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+    gpio_port_value_t values = 0;
+    uint8_t bus = 0;
+    uint8_t i;
 
-    /* Low bits */
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D4, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D5, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D6, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D7, LOW);
-    if ((bits & BIT(0)) == BIT(0))
+    gpio_emul_output_get_masked(cfg->bus[0].port, lcd_data->bus_mask, &values);
+
+    /* bus[] lists D4..D7 or D0..D7; line up D7 with bit 7 either way */
+    for (i = 0; i < cfg->bus_width; i++)
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D4, HIGH);
+        if (values & BIT(cfg->bus[i].pin))
+        {
+            bus |= BIT(i + 8 - cfg->bus_width);
+        }
     }
-    if ((bits & BIT(1)) == BIT(1))
+
+    lcd_model_strobe(&lcd_data->model,
+                     gpio_emul_output_get(cfg->rs.port, cfg->rs.pin) > 0, bus);
+}
+#endif
+
+static void _pi_lcd_toggle_enable(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+
+    /* 'E' idles low; data is latched on the falling edge */
+    GPIO_PIN_WR(cfg->e.port, cfg->e.pin, HIGH);
+    k_busy_wait(LCD_ENABLE_PULSE_US);
+    GPIO_PIN_WR(cfg->e.port, cfg->e.pin, LOW);
+#if defined(CONFIG_LCD16X2_MODEL)
+    _pi_lcd_model_strobe(dev);
+#endif
+    k_busy_wait(LCD_ENABLE_CYCLE_US);
+}
+
+#if defined(CONFIG_LCD16X2_BUSY_FLAG)
+/* Switch every data line in use between driving and listening */
+static void _pi_lcd_bus_dir(const struct device *dev, gpio_flags_t dir)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    uint8_t i;
+
+    for (i = 0; i < cfg->bus_width; i++)
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D5, HIGH);
+        GPIO_PIN_CFG(cfg->bus[i].port, cfg->bus[i].pin, dir);
     }
-    if ((bits & BIT(2)) == BIT(2))
+}
+
+/* Read the busy flag from D7 with RS low and R/W high. In 4-bit mode
+ * the second (address counter low) nibble must be clocked out too.
+ */
+static bool _pi_lcd_busy(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    const struct gpio_dt_spec *d7 = &cfg->bus[cfg->bus_width - 1];
+    int bf;
+
+    GPIO_PIN_WR(cfg->e.port, cfg->e.pin, HIGH);
+    k_busy_wait(LCD_ENABLE_PULSE_US);
+    bf = gpio_pin_get_raw(d7->port, d7->pin);
+    GPIO_PIN_WR(cfg->e.port, cfg->e.pin, LOW);
+    k_busy_wait(LCD_ENABLE_CYCLE_US);
+
+    if (cfg->bus_width == 4U)
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D6, HIGH);
+        _pi_lcd_toggle_enable(dev);
     }
-    if ((bits & BIT(3)) == BIT(3))
+
+    return bf != 0;
+}
+#endif
+
+/* Wait until the controller can take the next byte. With the busy flag
+ * available this returns as soon as BF drops; otherwise, or if BF never
+ * drops, the datasheet execution time is the bound.
+ */
+static void _pi_lcd_wait_ready(const struct device *dev, uint32_t usec)
+{
+#if defined(CONFIG_LCD16X2_BUSY_FLAG)
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+    int64_t deadline;
+    bool busy;
+
+    if (lcd_data->bf_ready && (cfg->rw.port != NULL))
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D7, HIGH);
+        deadline = k_uptime_get() + (usec / USEC_PER_MSEC) + 1;
+
+        _pi_lcd_bus_dir(dev, GPIO_INPUT);
+        GPIO_PIN_WR(cfg->rs.port, cfg->rs.pin, LOW);
+        gpio_pin_set_dt(&cfg->rw, HIGH);
+
+        do
+        {
+            busy = _pi_lcd_busy(dev);
+        } while (busy && (k_uptime_get() <= deadline));
+
+        gpio_pin_set_dt(&cfg->rw, LOW);
+        _pi_lcd_bus_dir(dev, GPIO_OUTPUT);
+
+        if (busy)
+        {
+            printk("%s: busy flag stuck, check R/W wiring\n", dev->name);
+        }
+        return;
     }
+#endif
 
-    /* Toggle 'Enable' pin */
-    _pi_lcd_toggle_enable(gpio_dev);
+    _pi_lcd_delay_us(usec);
 }
 
-void _pi_lcd_8bits_wr(const struct device *gpio_dev, uint8_t bits)
+static void _pi_lcd_4bits_wr(const struct device *dev, uint8_t bits)
 {
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+
     /* High bits */
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D7, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D6, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D5, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D4, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D3, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D2, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D1, LOW);
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_D0, LOW);
+    GPIO_PORT_WR(cfg->bus[0].port, lcd_data->bus_mask,
+                 lcd_data->bus_lut_hi[bits >> 4]);
+
+    /* Toggle 'Enable' pin */
+    _pi_lcd_toggle_enable(dev);
 
     /* Low bits */
-    if ((bits & BIT(0)) == BIT(0))
-    {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D0, HIGH);
-    }
-    if ((bits & BIT(1)) == BIT(1))
-    {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D1, HIGH);
-    }
-    if ((bits & BIT(2)) == BIT(2))
-    {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D2, HIGH);
-    }
-    if ((bits & BIT(3)) == BIT(3))
-    {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D3, HIGH);
-    }
-    if ((bits & BIT(4)) == BIT(4))
+    GPIO_PORT_WR(cfg->bus[0].port, lcd_data->bus_mask,
+                 lcd_data->bus_lut_hi[bits & 0x0F]);
+
+    /* Toggle 'Enable' pin */
+    _pi_lcd_toggle_enable(dev);
+}
+
+static void _pi_lcd_8bits_wr(const struct device *dev, uint8_t bits)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    /* All eight lines settle in the one port write */
+    GPIO_PORT_WR(cfg->bus[0].port, lcd_data->bus_mask,
+                 lcd_data->bus_lut_hi[bits >> 4] |
+                 lcd_data->bus_lut_lo[bits & 0x0F]);
+
+    /* Toggle 'Enable' pin */
+    _pi_lcd_toggle_enable(dev);
+}
+
+/* Precompute the port value for every nibble so each bus write is a
+ * single masked port access instead of a clear-then-set per pin.
+ */
+static void _pi_lcd_build_bus_lut(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+    const struct gpio_dt_spec *hi_pins = &cfg->bus[cfg->bus_width - 4];
+    const struct gpio_dt_spec *lo_pins = &cfg->bus[0];
+    uint8_t nibble;
+    uint8_t i;
+
+    lcd_data->bus_mask = 0;
+    for (i = 0; i < cfg->bus_width; i++)
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D4, HIGH);
+        lcd_data->bus_mask |= BIT(cfg->bus[i].pin);
     }
-    if ((bits & BIT(5)) == BIT(5))
+
+    for (nibble = 0; nibble < ARRAY_SIZE(lcd_data->bus_lut_hi); nibble++)
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D5, HIGH);
+        lcd_data->bus_lut_hi[nibble] = 0;
+        lcd_data->bus_lut_lo[nibble] = 0;
+        for (i = 0; i < 4; i++)
+        {
+            if (nibble & BIT(i))
+            {
+                lcd_data->bus_lut_hi[nibble] |= BIT(hi_pins[i].pin);
+                if (cfg->bus_width == 8U)
+                {
+                    lcd_data->bus_lut_lo[nibble] |= BIT(lo_pins[i].pin);
+                }
+            }
+        }
     }
-    if ((bits & BIT(6)) == BIT(6))
+}
+
+static void _pi_lcd_data(const struct device *dev, uint8_t bits)
+{
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    if (lcd_data->disp_func & LCD_8BIT_MODE)
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D6, HIGH);
+        _pi_lcd_8bits_wr(dev, bits);
     }
-    if ((bits & BIT(7)) == BIT(7))
+    else
     {
-        GPIO_PIN_WR(gpio_dev, GPIO_PIN_D7, HIGH);
+        _pi_lcd_4bits_wr(dev, bits);
     }
-
-    /* Toggle 'Enable' pin */
-    _pi_lcd_toggle_enable(gpio_dev);
 }
 
-void _pi_lcd_data(const struct device *gpio_dev, uint8_t bits)
+static void _pi_lcd_command(const struct device *dev, uint8_t bits)
 {
-    if (lcd_data.disp_func & LCD_8BIT_MODE)
+    const struct pi_lcd_config *cfg = dev->config;
+
+    /* mode = False for command */
+    GPIO_PIN_WR(cfg->rs.port, cfg->rs.pin, LOW);
+    _pi_lcd_data(dev, bits);
+
+    /* Clear display (0x01) and return home (0x02/0x03) are the slow ones */
+    if ((bits & ~LCD_RETURN_HOME_MASK) == 0U)
     {
-        _pi_lcd_8bits_wr(gpio_dev, bits);
+        _pi_lcd_wait_ready(dev, LCD_CLEAR_HOME_TIME_US);
     }
     else
     {
-        _pi_lcd_4bits_wr(gpio_dev, bits);
+        _pi_lcd_wait_ready(dev, LCD_EXEC_TIME_US);
     }
 }
 
-void _pi_lcd_command(const struct device *gpio_dev, uint8_t bits)
+static void _pi_lcd_write_raw(const struct device *dev, uint8_t bits)
 {
-    /* mode = False for command */
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_RS, LOW);
-    _pi_lcd_data(gpio_dev, bits);
+    const struct pi_lcd_config *cfg = dev->config;
+
+    /* mode = True for character */
+    GPIO_PIN_WR(cfg->rs.port, cfg->rs.pin, HIGH);
+    _pi_lcd_data(dev, bits);
+    _pi_lcd_wait_ready(dev, LCD_EXEC_TIME_US);
 }
 
-void _pi_lcd_write(const struct device *gpio_dev, uint8_t bits)
+static void _pi_lcd_write(const struct device *dev, uint8_t bits)
 {
-    /* mode = True for character */
-    GPIO_PIN_WR(gpio_dev, GPIO_PIN_RS, HIGH);
-    _pi_lcd_data(gpio_dev, bits);
+    struct pi_lcd_data *lcd_data = dev->data;
+    uint8_t col;
+    uint8_t row;
+
+    _pi_lcd_write_raw(dev, bits);
+
+    /* Keep the shadow in step with the DDRAM write we just did */
+    if (lcd_data->cursor == LCD_CURSOR_UNKNOWN)
+    {
+        return;
+    }
+
+    if (_pi_lcd_addr_to_cell(dev, lcd_data->cursor, &col, &row))
+    {
+        lcd_data->shadow[LCD_CELL(dev, row, col)] = bits;
+    }
+
+    if (lcd_data->disp_mode & LCD_ENTRY_LEFT)
+    {
+        lcd_data->cursor++;
+    }
+    else
+    {
+        lcd_data->cursor--;
+    }
 }
 
 /*************************
  * USER can use these APIs
  *************************/
 /** Home */
-void pi_lcd_home(const struct device *gpio_dev)
+void pi_lcd_home(const struct device *dev)
 {
-    _pi_lcd_command(gpio_dev, LCD_RETURN_HOME);
-    k_sleep(K_MSEC(2));         /* wait for 2ms */
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    _pi_lcd_command(dev, LCD_RETURN_HOME);
+    lcd_data->cursor = 0x00;
 }
 
 /** Set cursor position */
-void pi_lcd_set_cursor(const struct device *gpio_dev, uint8_t col,
+void pi_lcd_set_cursor(const struct device *dev, uint8_t col,
                        uint8_t row)
 {
-    size_t max_lines;
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
 
-    max_lines = ARRAY_SIZE(lcd_data.row_offsets);
-    if (row >= max_lines)
-    {
-        row = max_lines - 1;    /* Count rows starting w/0 */
-    }
-    if (row >= lcd_data.cfg_rows)
+    if (row >= cfg->rows)
     {
-        row = lcd_data.cfg_rows - 1;    /* Count rows starting w/0 */
+        row = cfg->rows - 1;    /* Count rows starting w/0 */
     }
-    _pi_lcd_command(gpio_dev, (LCD_SET_DDRAM_ADDR | (col + lcd_data.row_offsets[row])));
+    lcd_data->cursor = col + lcd_data->row_offsets[row];
+    _pi_lcd_command(dev, (LCD_SET_DDRAM_ADDR | lcd_data->cursor));
 }
 
 /** Clear display */
-void pi_lcd_clear(const struct device *gpio_dev)
+void pi_lcd_clear(const struct device *dev)
 {
-    _pi_lcd_command(gpio_dev, LCD_CLEAR_DISPLAY);
-    k_sleep(K_MSEC(2));         /* wait for 2ms */
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    _pi_lcd_command(dev, LCD_CLEAR_DISPLAY);
+
+    /* Clear fills the DDRAM with spaces and homes the cursor */
+    memset(lcd_data->shadow, ' ', cfg->rows * cfg->columns);
+    lcd_data->cursor = 0x00;
+}
+
+/* Shared by the display/cursor/blink on-off APIs */
+static void _pi_lcd_display_control(const struct device *dev,
+                                    uint8_t set, uint8_t clear)
+{
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    lcd_data->disp_cntl = (lcd_data->disp_cntl & ~clear) | set;
+    _pi_lcd_command(dev, LCD_DISPLAY_CONTROL | lcd_data->disp_cntl);
+}
+
+/* Shared by the text direction/auto scroll APIs */
+static void _pi_lcd_entry_mode(const struct device *dev,
+                               uint8_t set, uint8_t clear)
+{
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    lcd_data->disp_mode = (lcd_data->disp_mode & ~clear) | set;
+    _pi_lcd_command(dev, LCD_ENTRY_MODE_SET | lcd_data->disp_mode);
 }
 
 /** Display ON */
-void pi_lcd_display_on(const struct device *gpio_dev)
+void pi_lcd_display_on(const struct device *dev)
 {
-    lcd_data.disp_cntl |= LCD_DISPLAY_ON;
-    _pi_lcd_command(gpio_dev,
-                    LCD_DISPLAY_CONTROL | lcd_data.disp_cntl);
+    _pi_lcd_display_control(dev, LCD_DISPLAY_ON, 0);
 }
 
 /** Display OFF */
-void pi_lcd_display_off(const struct device *gpio_dev)
+void pi_lcd_display_off(const struct device *dev)
 {
-    lcd_data.disp_cntl &= ~LCD_DISPLAY_ON;
-    _pi_lcd_command(gpio_dev,
-                    LCD_DISPLAY_CONTROL | lcd_data.disp_cntl);
+    _pi_lcd_display_control(dev, 0, LCD_DISPLAY_ON);
 }
 
 /** Turns cursor off */
-void pi_lcd_cursor_off(const struct device *gpio_dev)
+void pi_lcd_cursor_off(const struct device *dev)
 {
-    lcd_data.disp_cntl &= ~LCD_CURSOR_ON;
-    _pi_lcd_command(gpio_dev,
-                    LCD_DISPLAY_CONTROL | lcd_data.disp_cntl);
+    _pi_lcd_display_control(dev, 0, LCD_CURSOR_ON);
 }
 
 /** Turn cursor on */
-void pi_lcd_cursor_on(const struct device *gpio_dev)
+void pi_lcd_cursor_on(const struct device *dev)
 {
-    lcd_data.disp_cntl |= LCD_CURSOR_ON;
-    _pi_lcd_command(gpio_dev,
-                    LCD_DISPLAY_CONTROL | lcd_data.disp_cntl);
+    _pi_lcd_display_control(dev, LCD_CURSOR_ON, 0);
 }
 
 /** Turn off the blinking cursor */
-void pi_lcd_blink_off(const struct device *gpio_dev)
+void pi_lcd_blink_off(const struct device *dev)
 {
-    lcd_data.disp_cntl &= ~LCD_BLINK_ON;
-    _pi_lcd_command(gpio_dev,
-                    LCD_DISPLAY_CONTROL | lcd_data.disp_cntl);
+    _pi_lcd_display_control(dev, 0, LCD_BLINK_ON);
 }
 
 /** Turn on the blinking cursor */
-void pi_lcd_blink_on(const struct device *gpio_dev)
+void pi_lcd_blink_on(const struct device *dev)
 {
-    lcd_data.disp_cntl |= LCD_BLINK_ON;
-    _pi_lcd_command(gpio_dev,
-                    LCD_DISPLAY_CONTROL | lcd_data.disp_cntl);
+    _pi_lcd_display_control(dev, LCD_BLINK_ON, 0);
 }
 
 /** Scroll the display left without changing the RAM */
-void pi_lcd_scroll_left(const struct device *gpio_dev)
+void pi_lcd_scroll_left(const struct device *dev)
 {
-    _pi_lcd_command(gpio_dev, LCD_CURSOR_SHIFT |
+    _pi_lcd_command(dev, LCD_CURSOR_SHIFT |
                     LCD_DISPLAY_MOVE | LCD_MOVE_LEFT);
 }
 
 /** Scroll the display right without changing the RAM */
-void pi_lcd_scroll_right(const struct device *gpio_dev)
+void pi_lcd_scroll_right(const struct device *dev)
 {
-    _pi_lcd_command(gpio_dev, LCD_CURSOR_SHIFT |
+    _pi_lcd_command(dev, LCD_CURSOR_SHIFT |
                     LCD_DISPLAY_MOVE | LCD_MOVE_RIGHT);
 }
 
 /** Text that flows from left to right */
-void pi_lcd_left_to_right(const struct device *gpio_dev)
+void pi_lcd_left_to_right(const struct device *dev)
 {
-    lcd_data.disp_mode |= LCD_ENTRY_LEFT;
-    _pi_lcd_command(gpio_dev,
-                    LCD_ENTRY_MODE_SET | lcd_data.disp_cntl);
+    _pi_lcd_entry_mode(dev, LCD_ENTRY_LEFT, 0);
 }
 
 /** Text that flows from right to left */
-void pi_lcd_right_to_left(const struct device *gpio_dev)
+void pi_lcd_right_to_left(const struct device *dev)
 {
-    lcd_data.disp_mode &= ~LCD_ENTRY_LEFT;
-    _pi_lcd_command(gpio_dev,
-                    LCD_ENTRY_MODE_SET | lcd_data.disp_cntl);
+    _pi_lcd_entry_mode(dev, 0, LCD_ENTRY_LEFT);
 }
 
 /** Right justify text from the cursor location */
-void pi_lcd_auto_scroll_right(const struct device *gpio_dev)
+void pi_lcd_auto_scroll_right(const struct device *dev)
 {
-    lcd_data.disp_mode |= LCD_ENTRY_SHIFT_INCREMENT;
-    _pi_lcd_command(gpio_dev,
-                    LCD_ENTRY_MODE_SET | lcd_data.disp_cntl);
+    _pi_lcd_entry_mode(dev, LCD_ENTRY_SHIFT_INCREMENT, 0);
 }
 
 /** Left justify text from the cursor location */
-void pi_lcd_auto_scroll_left(const struct device *gpio_dev)
+void pi_lcd_auto_scroll_left(const struct device *dev)
 {
-    lcd_data.disp_mode &= ~LCD_ENTRY_SHIFT_INCREMENT;
-    _pi_lcd_command(gpio_dev,
-                    LCD_ENTRY_MODE_SET | lcd_data.disp_cntl);
+    _pi_lcd_entry_mode(dev, 0, LCD_ENTRY_SHIFT_INCREMENT);
 }
 
-void pi_lcd_string(const struct device *gpio_dev, char *msg)
+void pi_lcd_string(const struct device *dev, char *msg)
 {
+    const struct pi_lcd_config *cfg = dev->config;
     int i;
     int len = 0;
     uint8_t data;
 
     len = strlen(msg);
-    if (len > LCD_WIDTH)
+    if (len > cfg->columns)
     {
         printk("Too long message! len %d %s\n", len, msg);
     }
@@ -314,27 +493,199 @@ void pi_lcd_string(const struct device *gpio_dev, char *msg)
     for (i = 0; i < len; i++)
     {
         data = msg[i];
-        _pi_lcd_write(gpio_dev, data);
+        _pi_lcd_write(dev, data);
     }
 }
 
-/** LCD initialization function */
-void pi_lcd_init(const struct device *gpio_dev, uint8_t cols, uint8_t rows,
-                 uint8_t dotsize)
+/** Blank the pending frame; nothing is sent until pi_lcd_commit() */
+void pi_lcd_frame_clear(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    memset(lcd_data->frame, ' ', cfg->rows * cfg->columns);
+}
+
+/** Place a string into the pending frame at (col, row), clipped to the row */
+void pi_lcd_frame_string(const struct device *dev, uint8_t col, uint8_t row,
+                         const char *msg)
 {
-    if (rows > 1)
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+
+    if (row >= cfg->rows)
     {
-        lcd_data.disp_func |= LCD_2_LINE;
+        printk("Frame row out of range! row %d %s\n", row, msg);
+        return;
     }
-    lcd_data.cfg_rows = rows;
 
-    _set_row_offsets(0x00, 0x40);
+    while ((col < cfg->columns) && (*msg != '\0'))
+    {
+        lcd_data->frame[LCD_CELL(dev, row, col++)] = *msg++;
+    }
+}
 
-    /* For 1 line displays, a 10 pixel high font looks OK */
-    if ((dotsize != LCD_5x8_DOTS) && (rows == 1U))
+/** Push only the cells of the pending frame that differ from the DDRAM */
+void pi_lcd_commit(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+    uint8_t row;
+    uint8_t col;
+    uint8_t addr;
+    size_t cell;
+
+    for (row = 0; row < cfg->rows; row++)
     {
-        lcd_data.disp_func |= LCD_5x10_DOTS;
+        for (col = 0; col < cfg->columns; col++)
+        {
+            cell = LCD_CELL(dev, row, col);
+            if (lcd_data->frame[cell] == lcd_data->shadow[cell])
+            {
+                continue;
+            }
+
+            /* Only reposition when auto-increment has not already
+             * left the address counter on this cell.
+             */
+            addr = col + lcd_data->row_offsets[row];
+            if ((lcd_data->cursor != addr) ||
+                !(lcd_data->disp_mode & LCD_ENTRY_LEFT))
+            {
+                pi_lcd_set_cursor(dev, col, row);
+            }
+
+            _pi_lcd_write(dev, lcd_data->frame[cell]);
+        }
     }
+}
+
+/** Define a custom 5x8 glyph, shown by character code slot (or slot + 8).
+ *  CGRAM writes are slow, so the slot is only rewritten when its bitmap
+ *  differs from what was last uploaded.
+ */
+int pi_lcd_glyph_set(const struct device *dev, uint8_t slot,
+                     const uint8_t bitmap[LCD_GLYPH_ROWS])
+{
+    struct pi_lcd_data *lcd_data = dev->data;
+    uint8_t i;
+
+    if (slot >= LCD_CGRAM_GLYPHS)
+    {
+        return -EINVAL;
+    }
+
+    if ((lcd_data->cgram_valid & BIT(slot)) &&
+        (memcmp(lcd_data->cgram[slot], bitmap, LCD_GLYPH_ROWS) == 0))
+    {
+        return 0;
+    }
+
+    _pi_lcd_command(dev, LCD_SET_CGRAM_ADDR | (slot * LCD_GLYPH_ROWS));
+    for (i = 0; i < LCD_GLYPH_ROWS; i++)
+    {
+        _pi_lcd_write_raw(dev, bitmap[i] & LCD_GLYPH_ROW_MASK);
+        lcd_data->cgram[slot][i] = bitmap[i];
+    }
+    lcd_data->cgram_valid |= BIT(slot);
+
+    /* The address counter now points into CGRAM, not at a cell */
+    lcd_data->cursor = LCD_CURSOR_UNKNOWN;
+
+    return 0;
+}
+
+/** Number of character columns of this instance */
+uint8_t pi_lcd_columns(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+
+    return cfg->columns;
+}
+
+/** Number of character rows of this instance */
+uint8_t pi_lcd_rows(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+
+    return cfg->rows;
+}
+
+/* Configure one control/data line as an idle-low output */
+static int _pi_lcd_pin_init(const struct gpio_dt_spec *spec)
+{
+    if (!device_is_ready(spec->port))
+    {
+        printk("Device %s not ready!\n", spec->port->name);
+        return -ENODEV;
+    }
+
+    return gpio_pin_configure_dt(spec, GPIO_OUTPUT_INACTIVE);
+}
+
+/** LCD device initialization, run once per devicetree instance */
+static int pi_lcd_init(const struct device *dev)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    struct pi_lcd_data *lcd_data = dev->data;
+    uint8_t i;
+    int rc;
+
+    /* Masked writes need the whole data bus on one port */
+    for (i = 0; i < cfg->bus_width; i++)
+    {
+        if (cfg->bus[i].port != cfg->bus[0].port)
+        {
+            printk("%s: data-gpios must share one port\n", dev->name);
+            return -ENOTSUP;
+        }
+
+        rc = _pi_lcd_pin_init(&cfg->bus[i]);
+        if (rc != 0)
+        {
+            return rc;
+        }
+    }
+
+    rc = _pi_lcd_pin_init(&cfg->rs);
+    if (rc == 0)
+    {
+        rc = _pi_lcd_pin_init(&cfg->e);
+    }
+    if ((rc == 0) && (cfg->rw.port != NULL))
+    {
+        rc = _pi_lcd_pin_init(&cfg->rw);
+    }
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    lcd_data->disp_func = (cfg->dotsize == 10U) ? LCD_5x10_DOTS : LCD_5x8_DOTS;
+    if (cfg->bus_width == 8U)
+    {
+        lcd_data->disp_func |= LCD_8BIT_MODE;
+    }
+    if (cfg->rows > 1)
+    {
+        lcd_data->disp_func |= LCD_2_LINE;
+    }
+
+    /* Rows 2/3 of 20x4 style panels continue rows 0/1 in DDRAM */
+    lcd_data->row_offsets[0] = 0x00;
+    lcd_data->row_offsets[1] = 0x40;
+    lcd_data->row_offsets[2] = cfg->columns;
+    lcd_data->row_offsets[3] = 0x40 + cfg->columns;
+    lcd_data->cursor = LCD_CURSOR_UNKNOWN;
+
+    _pi_lcd_build_bus_lut(dev);
+
+#if defined(CONFIG_LCD16X2_MODEL)
+    lcd_model_init(&lcd_data->model, cfg->columns, cfg->rows);
+#endif
+
+    /* BF cannot be trusted until the interface width is configured */
+    lcd_data->bf_ready = false;
 
     /* SEE PAGE 45/46 FOR INITIALIZATION SPECIFICATION!
      * according to datasheet, we need at least 40ms after power rises
@@ -346,53 +697,161 @@ void pi_lcd_init(const struct device *gpio_dev, uint8_t cols, uint8_t rows,
     /* this is according to the hitachi HD44780 datasheet
      * figure 23/24, pg 45/46 try to set 4/8 bits mode
      */
-    if (lcd_data.disp_func & LCD_8BIT_MODE)
+    if (lcd_data->disp_func & LCD_8BIT_MODE)
     {
         /* 1st try */
-        _pi_lcd_command(gpio_dev, 0x30);
+        _pi_lcd_command(dev, 0x30);
         k_sleep(K_MSEC(5));         /* wait for 5ms */
 
         /* 2nd try */
-        _pi_lcd_command(gpio_dev, 0x30);
+        _pi_lcd_command(dev, 0x30);
         k_sleep(K_MSEC(5));         /* wait for 5ms */
 
         /* 3rd try */
-        _pi_lcd_command(gpio_dev, 0x30);
-        k_sleep(K_MSEC(1));         /* wait for 1ms */
+        _pi_lcd_command(dev, 0x30);
+        _pi_lcd_delay_us(150);      /* wait for >100us */
 
         /* Set 4bit interface */
-        _pi_lcd_command(gpio_dev, 0x30);
+        _pi_lcd_command(dev, 0x30);
     }
     else
     {
         /* 1st try */
-        _pi_lcd_command(gpio_dev, 0x03);
+        _pi_lcd_command(dev, 0x03);
         k_sleep(K_MSEC(5));         /* wait for 5ms */
 
         /* 2nd try */
-        _pi_lcd_command(gpio_dev, 0x03);
+        _pi_lcd_command(dev, 0x03);
         k_sleep(K_MSEC(5));         /* wait for 5ms */
 
         /* 3rd try */
-        _pi_lcd_command(gpio_dev, 0x03);
-        k_sleep(K_MSEC(1));         /* wait for 1ms */
+        _pi_lcd_command(dev, 0x03);
+        _pi_lcd_delay_us(150);      /* wait for >100us */
 
         /* Set 4bit interface */
-        _pi_lcd_command(gpio_dev, 0x02);
+        _pi_lcd_command(dev, 0x02);
     }
 
     /* finally, set # lines, font size, etc. */
-    _pi_lcd_command(gpio_dev, (LCD_FUNCTION_SET | lcd_data.disp_func));
+    _pi_lcd_command(dev, (LCD_FUNCTION_SET | lcd_data->disp_func));
+
+    /* From here on every command can be paced by the busy flag */
+    lcd_data->bf_ready = true;
 
     /* turn the display on with no cursor or blinking default */
-    lcd_data.disp_cntl = LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF;
-    pi_lcd_display_on(gpio_dev);
+    lcd_data->disp_cntl = LCD_DISPLAY_ON | LCD_CURSOR_OFF | LCD_BLINK_OFF;
+    pi_lcd_display_on(dev);
 
     /* clear it off */
-    pi_lcd_clear(gpio_dev);
+    pi_lcd_clear(dev);
 
     /* Initialize to default text direction */
-    lcd_data.disp_mode = LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_DECREMENT;
+    lcd_data->disp_mode = LCD_ENTRY_LEFT | LCD_ENTRY_SHIFT_DECREMENT;
     /* set the entry mode */
-    _pi_lcd_command(gpio_dev, LCD_ENTRY_MODE_SET | lcd_data.disp_mode);
+    _pi_lcd_command(dev, LCD_ENTRY_MODE_SET | lcd_data->disp_mode);
+
+    /* The DDRAM was just cleared, so start with a matching blank frame */
+    pi_lcd_frame_clear(dev);
+
+    return 0;
+}
+
+#if defined(CONFIG_PM_DEVICE)
+/* Suspend blanks the panel and stops driving every line but E, which
+ * must stay low so nothing is latched; the HD44780 pulls its own inputs
+ * up. DDRAM and CGRAM survive while the module keeps its supply, so
+ * resume only drives the lines again and switches the panel back on.
+ */
+static int pi_lcd_pm_action(const struct device *dev,
+                            enum pm_device_action action)
+{
+    const struct pi_lcd_config *cfg = dev->config;
+    gpio_flags_t flags;
+    uint8_t i;
+    int rc = 0;
+
+    switch (action)
+    {
+    case PM_DEVICE_ACTION_SUSPEND:
+        pi_lcd_display_off(dev);
+        flags = GPIO_DISCONNECTED;
+        break;
+
+    case PM_DEVICE_ACTION_RESUME:
+        flags = GPIO_OUTPUT_INACTIVE;
+        break;
+
+    default:
+        return -ENOTSUP;
+    }
+
+    for (i = 0; (rc == 0) && (i < cfg->bus_width); i++)
+    {
+        rc = gpio_pin_configure_dt(&cfg->bus[i], flags);
+    }
+    if (rc == 0)
+    {
+        rc = gpio_pin_configure_dt(&cfg->rs, flags);
+    }
+    if ((rc == 0) && (cfg->rw.port != NULL))
+    {
+        rc = gpio_pin_configure_dt(&cfg->rw, flags);
+    }
+
+    if ((rc == 0) && (action == PM_DEVICE_ACTION_RESUME))
+    {
+        pi_lcd_display_on(dev);
+    }
+
+    return rc;
 }
+#endif
+
+#define PI_LCD_DEFINE(inst)                                                 \
+    static const struct gpio_dt_spec pi_lcd_bus_##inst[] =                  \
+    {                                                                       \
+        DT_INST_FOREACH_PROP_ELEM_SEP(inst, data_gpios,                     \
+                                      GPIO_DT_SPEC_GET_BY_IDX, (,))         \
+    };                                                                      \
+                                                                            \
+    BUILD_ASSERT((ARRAY_SIZE(pi_lcd_bus_##inst) == 4) ||                    \
+                 (ARRAY_SIZE(pi_lcd_bus_##inst) == 8),                      \
+                 "data-gpios must list 4 (D4..D7) or 8 (D0..D7) pins");     \
+    BUILD_ASSERT(DT_INST_PROP(inst, rows) <= LCD_MAX_ROWS,                  \
+                 "Too many LCD rows");                                      \
+    BUILD_ASSERT(DT_INST_PROP(inst, columns) <= LCD_MAX_COLUMNS,            \
+                 "Too many LCD columns");                                   \
+    BUILD_ASSERT((DT_INST_PROP(inst, dotsize) == 8) ||                      \
+                 (DT_INST_PROP(inst, rows) == 1),                           \
+                 "The 5x10 font needs a single-row panel");                 \
+                                                                            \
+    static char pi_lcd_shadow_##inst[DT_INST_PROP(inst, rows) *             \
+                                     DT_INST_PROP(inst, columns)];          \
+    static char pi_lcd_frame_##inst[DT_INST_PROP(inst, rows) *              \
+                                    DT_INST_PROP(inst, columns)];           \
+                                                                            \
+    static const struct pi_lcd_config pi_lcd_config_##inst =                \
+    {                                                                       \
+        .rs = GPIO_DT_SPEC_INST_GET(inst, rs_gpios),                        \
+        .e = GPIO_DT_SPEC_INST_GET(inst, e_gpios),                          \
+        .rw = GPIO_DT_SPEC_INST_GET_OR(inst, rw_gpios, {0}),                \
+        .bus = pi_lcd_bus_##inst,                                           \
+        .bus_width = ARRAY_SIZE(pi_lcd_bus_##inst),                         \
+        .columns = DT_INST_PROP(inst, columns),                             \
+        .rows = DT_INST_PROP(inst, rows),                                   \
+        .dotsize = DT_INST_PROP(inst, dotsize),                             \
+    };                                                                      \
+                                                                            \
+    static struct pi_lcd_data pi_lcd_data_##inst =                          \
+    {                                                                       \
+        .shadow = pi_lcd_shadow_##inst,                                     \
+        .frame = pi_lcd_frame_##inst,                                       \
+    };                                                                      \
+                                                                            \
+    PM_DEVICE_DT_INST_DEFINE(inst, pi_lcd_pm_action);                       \
+                                                                            \
+    DEVICE_DT_INST_DEFINE(inst, pi_lcd_init, PM_DEVICE_DT_INST_GET(inst),   \
+                          &pi_lcd_data_##inst, &pi_lcd_config_##inst,       \
+                          POST_KERNEL, CONFIG_LCD16X2_INIT_PRIORITY, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(PI_LCD_DEFINE)
@@ -51,7 +51,9 @@
  * 2 : 5V
  * 3 : Contrast (0-5V)*
  * 4 : RS (Register Select)
- * 5 : R/W (Read Write)       - GROUND THIS PIN
+ * 5 : R/W (Read Write)       - GROUND THIS PIN, unless the node
+ *                              has rw-gpios and
+ *                              CONFIG_LCD16X2_BUSY_FLAG is set
  * 6 : Enable or Strobe
  * 7 : Data Bit 0             - NOT USED
  * 8 : Data Bit 1             - NOT USED
@@ -76,29 +78,10 @@
 #include <zephyr/drivers/gpio.h>
 #include <string.h>
 
-/* Choose pins on the same port so as to make coding logic straightforward. */
-#define GPIO_NODE DT_NODELABEL(gpiof)
-
-// TBD, Nuertey Odzeyem; If using 8-bit mode, must define these pins as 
-// well. For now, and to encourage compilation, simply set to an UNUSED
-// dummy GPIO pin on the same port. The following satisfies:
-//
-// Connector: CN10 
-// Pin      : 2 
-// Pin Name : D7        * Arduino-equivalent pin name
-// STM32 Pin: PF13
-// Signal   : I/O
-#define GPIO_PIN_D0       13  /* NC in 4-bit mode */
-#define GPIO_PIN_D1       13  /* NC in 4-bit mode */
-#define GPIO_PIN_D2       13  /* NC in 4-bit mode */
-#define GPIO_PIN_D3       13  /* NC in 4-bit mode */
-
-#define GPIO_PIN_D4        8  /* PF8 */
-#define GPIO_PIN_D5        2  /* PF2 */
-#define GPIO_PIN_D6        1  /* PF1 */
-#define GPIO_PIN_D7        0  /* PF0 */
-#define GPIO_PIN_RS        9  /* PF9 */
-#define GPIO_PIN_E         7  /* PF7 */
+/* Pins, bus width and geometry come from a "nuertey,lcd16x2" devicetree
+ * node per display (see the board overlays); the data lines of one display
+ * must sit on the same GPIO port.
+ */
 #define GPIO_NAME         "GPIO_"
 
 /* Commands */
@@ -110,6 +93,7 @@
 #define LCD_FUNCTION_SET            0x20
 #define LCD_SET_CGRAM_ADDR          0x40
 #define LCD_SET_DDRAM_ADDR          0x80
+#define LCD_RETURN_HOME_MASK        0x03  /* Clear/home occupy bits 0-1 */
 
 /* Display entry mode */
 #define LCD_ENTRY_RIGHT             0x00
@@ -140,12 +124,22 @@
 #define LCD_5x8_DOTS                0x00
 
 /* Define some device constants */
-#define LCD_WIDTH                     16  /* Max char per line */
+#define LCD_MAX_COLUMNS               40  /* Max char per line */
+#define LCD_MAX_ROWS                   4  /* Max lines */
+#define LCD_CGRAM_GLYPHS               8  /* Custom 5x8 characters */
+#define LCD_GLYPH_ROWS                 8  /* Pixel rows per 5x8 glyph */
+#define LCD_GLYPH_ROW_MASK          0x1F  /* 5 pixels per glyph row */
+#define LCD_CURSOR_UNKNOWN          0xFF  /* DDRAM address not tracked */
 #define HIGH                           1
 #define LOW                            0
 
-/* in millisecond */
-#define ENABLE_DELAY                  10
+/* HD44780 timings in microseconds, from the datasheet (fosc = 270 kHz)
+ * with some margin for slower RC oscillators on cheap modules.
+ */
+#define LCD_ENABLE_PULSE_US            1  /* PW_EH >= 450 ns */
+#define LCD_ENABLE_CYCLE_US            1  /* t_cycE >= 1000 ns */
+#define LCD_EXEC_TIME_US              50  /* Most commands/data: 37 us */
+#define LCD_CLEAR_HOME_TIME_US      2000  /* Clear display/return home: 1.52 ms */
 
 
 /******************************************
@@ -158,6 +152,13 @@
         }                               \
     } while (0)                             \
 
+#define GPIO_PORT_WR(dev, mask, value)                  \
+    do {                                    \
+        if (gpio_port_set_masked_raw((dev), (mask), (value))) {     \
+            printk("Err set " GPIO_NAME "%x! %x\n", (mask), (value)); \
+        }                               \
+    } while (0)
+
 #define GPIO_PIN_CFG(dev, pin, dir)                     \
     do {                                    \
         if (gpio_pin_configure((dev), (pin), (dir))) {          \
@@ -165,20 +166,27 @@
         }                               \
     } while (0)
 
-void pi_lcd_home(const struct device *gpio_dev);
-void pi_lcd_set_cursor(const struct device *gpio_dev, uint8_t col, uint8_t row);
-void pi_lcd_clear(const struct device *gpio_dev);
-void pi_lcd_display_on(const struct device *gpio_dev);
-void pi_lcd_display_off(const struct device *gpio_dev);
-void pi_lcd_cursor_off(const struct device *gpio_dev);
-void pi_lcd_cursor_on(const struct device *gpio_dev);
-void pi_lcd_blink_off(const struct device *gpio_dev);
-void pi_lcd_blink_on(const struct device *gpio_dev);
-void pi_lcd_scroll_left(const struct device *gpio_dev);
-void pi_lcd_scroll_right(const struct device *gpio_dev);
-void pi_lcd_left_to_right(const struct device *gpio_dev);
-void pi_lcd_right_to_left(const struct device *gpio_dev);
-void pi_lcd_auto_scroll_right(const struct device *gpio_dev);
-void pi_lcd_auto_scroll_left(const struct device *gpio_dev);
-void pi_lcd_string(const struct device *gpio_dev, char *msg);
-void pi_lcd_init(const struct device *gpio_dev, uint8_t cols, uint8_t rows, uint8_t dotsize);
+void pi_lcd_home(const struct device *dev);
+void pi_lcd_set_cursor(const struct device *dev, uint8_t col, uint8_t row);
+void pi_lcd_clear(const struct device *dev);
+void pi_lcd_display_on(const struct device *dev);
+void pi_lcd_display_off(const struct device *dev);
+void pi_lcd_cursor_off(const struct device *dev);
+void pi_lcd_cursor_on(const struct device *dev);
+void pi_lcd_blink_off(const struct device *dev);
+void pi_lcd_blink_on(const struct device *dev);
+void pi_lcd_scroll_left(const struct device *dev);
+void pi_lcd_scroll_right(const struct device *dev);
+void pi_lcd_left_to_right(const struct device *dev);
+void pi_lcd_right_to_left(const struct device *dev);
+void pi_lcd_auto_scroll_right(const struct device *dev);
+void pi_lcd_auto_scroll_left(const struct device *dev);
+void pi_lcd_string(const struct device *dev, char *msg);
+void pi_lcd_frame_clear(const struct device *dev);
+void pi_lcd_frame_string(const struct device *dev, uint8_t col, uint8_t row,
+                         const char *msg);
+void pi_lcd_commit(const struct device *dev);
+int pi_lcd_glyph_set(const struct device *dev, uint8_t slot,
+                     const uint8_t bitmap[LCD_GLYPH_ROWS]);
+uint8_t pi_lcd_columns(const struct device *dev);
+uint8_t pi_lcd_rows(const struct device *dev);
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "lcd_model.h"
+#include "lcd16x2.h"
+#include <zephyr/sys/printk.h>
+
+/* DDRAM start of each row, as the 2-line controller lays it out */
+static uint8_t lcd_model_row_offset(const struct lcd_model *model, uint8_t row)
+{
+    return ((row & 1U) ? 0x40 : 0x00) + ((row >> 1) * model->columns);
+}
+
+static void lcd_model_dump(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct lcd_model *model = CONTAINER_OF(dwork, struct lcd_model, dump);
+    char line[LCD_MAX_COLUMNS + 1];
+
+    if (memcmp(model->shown, model->ddram, sizeof(model->ddram)) == 0)
+    {
+        return;
+    }
+    memcpy(model->shown, model->ddram, sizeof(model->ddram));
+
+    for (uint8_t row = 0; row < model->rows; row++)
+    {
+        lcd_model_row(model, row, line, sizeof(line));
+        printk("LCD%u |%s|\n", row, line);
+    }
+}
+
+void lcd_model_init(struct lcd_model *model, uint8_t columns, uint8_t rows)
+{
+    memset(model, 0, sizeof(*model));
+    memset(model->ddram, ' ', sizeof(model->ddram));
+    memset(model->shown, ' ', sizeof(model->shown));
+
+    /* Power-on state: 8-bit interface, incrementing addresses */
+    model->increment = true;
+    model->columns = columns;
+    model->rows = rows;
+
+    k_work_init_delayable(&model->dump, lcd_model_dump);
+}
+
+static void lcd_model_step_addr(struct lcd_model *model)
+{
+    model->addr = (model->increment ? model->addr + 1 : model->addr - 1) &
+                  (LCD_MODEL_DDRAM_SIZE - 1);
+}
+
+static void lcd_model_command(struct lcd_model *model, uint8_t cmd)
+{
+    if (cmd & LCD_SET_DDRAM_ADDR)
+    {
+        model->addr = cmd & (LCD_MODEL_DDRAM_SIZE - 1);
+        model->cgram = false;
+    }
+    else if (cmd & LCD_SET_CGRAM_ADDR)
+    {
+        model->cgram = true;
+    }
+    else if (cmd & LCD_FUNCTION_SET)
+    {
+        model->nibble_mode = !(cmd & LCD_8BIT_MODE);
+    }
+    else if (cmd & (LCD_CURSOR_SHIFT | LCD_DISPLAY_CONTROL))
+    {
+        /* Display shifts and on/off do not change the DDRAM contents */
+    }
+    else if (cmd & LCD_ENTRY_MODE_SET)
+    {
+        model->increment = (cmd & LCD_ENTRY_LEFT) != 0U;
+    }
+    else if (cmd & LCD_RETURN_HOME)
+    {
+        model->addr = 0;
+        model->cgram = false;
+    }
+    else if (cmd & LCD_CLEAR_DISPLAY)
+    {
+        memset(model->ddram, ' ', sizeof(model->ddram));
+        model->addr = 0;
+        model->cgram = false;
+        model->increment = true;
+    }
+}
+
+/** One E falling edge: 'bus' holds D7..D0; only D7..D4 are wired in
+ *  4-bit mode, so the low nibble then reads as 0.
+ */
+void lcd_model_strobe(struct lcd_model *model, bool rs, uint8_t bus)
+{
+    uint8_t byte = bus;
+
+    if (model->nibble_mode)
+    {
+        if (!model->have_high)
+        {
+            model->high = bus & 0xF0;
+            model->have_high = true;
+            return;
+        }
+
+        byte = model->high | (bus >> 4);
+        model->have_high = false;
+    }
+
+    if (!rs)
+    {
+        lcd_model_command(model, byte);
+    }
+    else
+    {
+        if (!model->cgram)
+        {
+            model->ddram[model->addr] = byte;
+        }
+        lcd_model_step_addr(model);
+    }
+
+    k_work_reschedule(&model->dump, K_MSEC(CONFIG_LCD16X2_MODEL_SETTLE_MS));
+}
+
+/** Text of one row; CGRAM characters (codes 0-15) show as '#' */
+void lcd_model_row(const struct lcd_model *model, uint8_t row, char *buf,
+                   size_t size)
+{
+    uint8_t offset = lcd_model_row_offset(model, row);
+    size_t col;
+
+    for (col = 0; (col < model->columns) && (col + 1 < size); col++)
+    {
+        char c = model->ddram[(offset + col) & (LCD_MODEL_DDRAM_SIZE - 1)];
+
+        buf[col] = ((uint8_t)c < 0x10) ? '#' : c;
+    }
+    buf[col] = '\0';
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file HD44780 model fed from emulated GPIO traffic, for native_posix.
+ *
+ * On every falling edge of E, the LCD driver samples RS and the data
+ * lines back from the emulated GPIO controller and hands them to the
+ * model. The model then behaves as the controller would: it starts in
+ * 8-bit mode, pairs nibbles once a 4-bit function set arrives, follows
+ * DDRAM/CGRAM addressing and entry mode, and stores characters. The
+ * text is reconstructed from the pin levels alone, so it shows exactly
+ * what a real panel would. It is printed whenever it settles after a
+ * change.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#define LCD_MODEL_DDRAM_SIZE        0x80
+
+struct lcd_model
+{
+    bool nibble_mode;           /* 4-bit interface selected */
+    bool have_high;             /* First nibble of a 4-bit transfer seen */
+    uint8_t high;
+    bool cgram;                 /* Data writes go to CGRAM, not DDRAM */
+    bool increment;             /* Entry mode I/D */
+    uint8_t addr;
+    uint8_t columns;
+    uint8_t rows;
+    char ddram[LCD_MODEL_DDRAM_SIZE];
+    char shown[LCD_MODEL_DDRAM_SIZE];   /* As last printed */
+    struct k_work_delayable dump;
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void lcd_model_init(struct lcd_model *model, uint8_t columns, uint8_t rows);
+void lcd_model_strobe(struct lcd_model *model, bool rs, uint8_t bus);
+void lcd_model_row(const struct lcd_model *model, uint8_t row, char *buf,
+                   size_t size);
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "lcd_render.h"
+#include "latency_stats.h"
+#include <zephyr/sys/atomic.h>
+#include <zephyr/pm/device.h>
+
+K_THREAD_STACK_ARRAY_DEFINE(lcd_render_stacks, LCD_RENDER_PANELS,
+                            CONFIG_LCD_RENDER_STACK_SIZE);
+
+/* One render thread and one set of row mailboxes per panel. The newest
+ * text per row wins and the dirty bit tells the render thread which rows
+ * to pick up. The spinlock only guards the short memcpy, so producers
+ * never sleep.
+ */
+struct lcd_render
+{
+    const struct device *lcd;   /* NULL until lcd_render_start() */
+    struct k_thread thread;
+    struct k_spinlock lock;
+    char rows[LCD_MAX_ROWS][LCD_MAX_COLUMNS + 1];
+    atomic_t dirty;
+    struct k_sem sem;
+};
+
+static struct lcd_render lcd_renders[LCD_RENDER_PANELS];
+
+static struct lcd_render *lcd_render_find(const struct device *lcd)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(lcd_renders); i++)
+    {
+        if (lcd_renders[i].lcd == lcd)
+        {
+            return &lcd_renders[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void lcd_render_loop(void *p1, void *p2, void *p3)
+{
+    struct lcd_render *render = p1;
+    const struct device *lcd = render->lcd;
+    char text[LCD_MAX_COLUMNS + 1];
+    atomic_val_t dirty;
+    k_spinlock_key_t key;
+    uint32_t start;
+    uint8_t row;
+#if defined(CONFIG_APP_DUTY_CYCLE)
+    bool awake = true;
+#endif
+
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (true)
+    {
+#if defined(CONFIG_APP_DUTY_CYCLE)
+        /* Blank and park the panel once nothing new has arrived for a
+         * while; the next posted row wakes it again.
+         */
+        if (k_sem_take(&render->sem,
+                       awake ? K_MSEC(CONFIG_APP_DUTY_CYCLE_DISPLAY_MS) :
+                               K_FOREVER) != 0)
+        {
+            (void)pm_device_action_run(lcd, PM_DEVICE_ACTION_SUSPEND);
+            awake = false;
+            continue;
+        }
+
+        if (!awake)
+        {
+            (void)pm_device_action_run(lcd, PM_DEVICE_ACTION_RESUME);
+            awake = true;
+        }
+#else
+        k_sem_take(&render->sem, K_FOREVER);
+#endif
+
+        start = latency_start();
+        dirty = atomic_clear(&render->dirty);
+        for (row = 0; row < pi_lcd_rows(lcd); row++)
+        {
+            if (!(dirty & BIT(row)))
+            {
+                continue;
+            }
+
+            key = k_spin_lock(&render->lock);
+            memcpy(text, render->rows[row], sizeof(text));
+            k_spin_unlock(&render->lock, key);
+
+            pi_lcd_frame_string(lcd, 0, row, text);
+        }
+
+        pi_lcd_commit(lcd);
+        latency_stop(LATENCY_LCD, start);
+    }
+}
+
+/** Hand a display over to its own render thread; returns -ENOMEM when
+ *  every panel already has one.
+ */
+int lcd_render_start(const struct device *lcd)
+{
+    struct lcd_render *render = lcd_render_find(NULL);
+    size_t i;
+
+    if (render == NULL)
+    {
+        return -ENOMEM;
+    }
+
+    i = render - lcd_renders;
+    render->lcd = lcd;
+    k_sem_init(&render->sem, 0, 1);
+
+    k_thread_create(&render->thread, lcd_render_stacks[i],
+                    K_THREAD_STACK_SIZEOF(lcd_render_stacks[i]),
+                    lcd_render_loop, render, NULL, NULL,
+                    CONFIG_LCD_RENDER_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&render->thread, "lcd_render");
+
+    return 0;
+}
+
+/** Post new text for a row of 'lcd'; never blocks, supersedes any
+ *  pending text.
+ */
+void lcd_render_row(const struct device *lcd, uint8_t row, const char *text)
+{
+    struct lcd_render *render = lcd_render_find(lcd);
+    k_spinlock_key_t key;
+    size_t len;
+
+    if (render == NULL)
+    {
+        printk("No render thread for %s!\n", lcd->name);
+        return;
+    }
+
+    if (row >= LCD_MAX_ROWS)
+    {
+        printk("Render row out of range! row %d %s\n", row, text);
+        return;
+    }
+
+    /* Pad with blanks so a shorter value erases the tail of the longer
+     * one it replaces.
+     */
+    len = strnlen(text, LCD_MAX_COLUMNS);
+    key = k_spin_lock(&render->lock);
+    memcpy(render->rows[row], text, len);
+    memset(&render->rows[row][len], ' ', LCD_MAX_COLUMNS - len);
+    render->rows[row][LCD_MAX_COLUMNS] = '\0';
+    k_spin_unlock(&render->lock, key);
+
+    atomic_or(&render->dirty, BIT(row));
+    k_sem_give(&render->sem);
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Asynchronous rendering front-end for the LCD16x2 driver.
+ *
+ * Producers post whole-row updates without blocking; a dedicated
+ * low-priority thread per panel owns that display and pushes them out
+ * through its shadow framebuffer. Only the latest text per row is kept, so a row
+ * that is updated faster than the display can keep up with simply
+ * supersedes its previous, not yet drawn, contents.
+ */
+#pragma once
+
+#include "lcd16x2.h"
+#include <zephyr/devicetree.h>
+
+/* Render threads available, one per enabled "nuertey,lcd16x2" node */
+#define LCD_RENDER_PANELS   MAX(DT_NUM_INST_STATUS_OKAY(nuertey_lcd16x2), 1)
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int lcd_render_start(const struct device *lcd);
+void lcd_render_row(const struct device *lcd, uint8_t row, const char *text);
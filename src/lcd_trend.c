@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "lcd_trend.h"
+
+static const uint8_t lcd_trend_glyphs[LCD_CGRAM_GLYPHS][LCD_GLYPH_ROWS] =
+{
+    /* Bars, bottom-aligned, 1..7 pixels high */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    {0x00, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F},
+    /* Degree sign */
+    {0x06, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00},
+};
+
+/** Upload the bar and degree glyphs; cheap once they are in CGRAM */
+int lcd_trend_glyphs_load(const struct device *lcd)
+{
+    uint8_t slot;
+    int rc;
+
+    for (slot = 0; slot < LCD_CGRAM_GLYPHS; slot++)
+    {
+        rc = pi_lcd_glyph_set(lcd, slot, lcd_trend_glyphs[slot]);
+        if (rc != 0)
+        {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/** Append a reading, dropping the oldest once the history is full */
+void lcd_trend_push(struct lcd_trend *trend, int32_t value)
+{
+    trend->samples[trend->head] = value;
+    trend->head = (trend->head + 1) % ARRAY_SIZE(trend->samples);
+    if (trend->count < ARRAY_SIZE(trend->samples))
+    {
+        trend->count++;
+    }
+}
+
+/** Draw the newest readings as bars scaled to their own min..max,
+ *  right-aligned in 'cells' characters. 'out' needs cells + 1 bytes.
+ */
+void lcd_trend_render(const struct lcd_trend *trend, char *out, size_t cells)
+{
+    int32_t min = INT32_MAX;
+    int32_t max = INT32_MIN;
+    int32_t value;
+    size_t shown = MIN(cells, (size_t)trend->count);
+    size_t first;
+    size_t i;
+    uint8_t level;
+
+    first = (trend->head + ARRAY_SIZE(trend->samples) - shown) %
+            ARRAY_SIZE(trend->samples);
+
+    for (i = 0; i < shown; i++)
+    {
+        value = trend->samples[(first + i) % ARRAY_SIZE(trend->samples)];
+        min = MIN(min, value);
+        max = MAX(max, value);
+    }
+
+    memset(out, ' ', cells - shown);
+    for (i = 0; i < shown; i++)
+    {
+        value = trend->samples[(first + i) % ARRAY_SIZE(trend->samples)];
+        if (max == min)
+        {
+            level = LCD_TREND_LEVELS / 2;
+        }
+        else
+        {
+            level = ((int64_t)(value - min) * (LCD_TREND_LEVELS - 1)) /
+                    (max - min);
+        }
+        out[cells - shown + i] = LCD_TREND_GLYPH_CODE(level);
+    }
+    out[cells] = '\0';
+}
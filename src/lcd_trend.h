@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Rolling mini-sparklines and a degree sign for the LCD16x2.
+ *
+ * Seven bar glyphs (1..7 pixels high) and a degree symbol occupy all
+ * eight CGRAM slots. The set never changes at runtime, so after the
+ * first lcd_trend_glyphs_load() the driver's glyph cache turns any
+ * further loads into no-ops.
+ */
+#pragma once
+
+#include "lcd16x2.h"
+
+/* CGRAM slots are addressed as codes 0x08..0x0F so they never read as
+ * the NUL terminator in a C string.
+ */
+#define LCD_TREND_GLYPH_CODE(slot)    (0x08 + (slot))
+#define LCD_TREND_LEVELS               7
+#define LCD_TREND_DEGREE_SLOT          7
+#define LCD_TREND_DEGREE_STR          "\x0F"
+
+struct lcd_trend
+{
+    int32_t samples[LCD_MAX_COLUMNS];
+    uint8_t head;   /* Next slot to overwrite */
+    uint8_t count;  /* Valid samples, up to LCD_MAX_COLUMNS */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int lcd_trend_glyphs_load(const struct device *lcd);
+void lcd_trend_push(struct lcd_trend *trend, int32_t value);
+void lcd_trend_render(const struct lcd_trend *trend, char *out, size_t cells);
@@ -3,7 +3,16 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "lcd16x2.h"
+#include "display.h"
+#include "lcd_trend.h"
+#include "sampler.h"
+#include "store_forward.h"
+#include "report_policy.h"
+#include "window_stats.h"
+#include "app_event.h"
+#include "duty_cycle.h"
+#include "payload_codec.h"
+#include "value_format.h"
 #include "mqtt_publisher.h"
 #include <zephyr/device.h>
 #include <zephyr/drivers/sensor.h>
@@ -11,145 +20,779 @@
 
 LOG_MODULE_DECLARE(dht11_and_lcd16x2, LOG_LEVEL_DBG);
 
-static const char *now_str(void)
+/* In-flight slots one reading takes; QoS 0 topics need none */
+#define RECORD_INFLIGHT_SLOTS   SENSOR_REGISTRY_ACKED_COUNT
+
+BUILD_ASSERT(RECORD_INFLIGHT_SLOTS <= APP_MQTT_INFLIGHT_MAX,
+             "In-flight window cannot hold one reading");
+
+/* Readings stay in store_forward until the broker has them. Each PUBLISH
+ * is tagged with the queue position just past the readings it carries,
+ * and once every flow up to a position is written and acknowledged the
+ * queue is popped up to there. A reboot in between sends them again.
+ */
+struct drain_flight
 {
-    static char buf[16]; /* ...HH:MM:SS.MMM */
-    uint32_t now = k_uptime_get_32();
-    unsigned int ms = now % MSEC_PER_SEC;
-    unsigned int s;
-    unsigned int min;
-    unsigned int h;
+    uint32_t end;           /* Queue position just past its readings */
+    uint8_t unacked;        /* QoS 1/2 flows awaiting acknowledgement */
+    bool written;           /* Every flow for the readings is written */
+};
 
-    now /= MSEC_PER_SEC;
-    s = now % 60U;
-    now /= 60U;
-    min = now % 60U;
-    now /= 60U;
-    h = now;
+/* Each entry holds an in-flight slot, but for the one being written */
+static struct drain_flight drain_flights[APP_MQTT_INFLIGHT_MAX + 1];
+static size_t drain_flight_first;
+static size_t drain_flight_count;
+static uint32_t drain_pos;      /* Queue position of the next reading to send */
+#if !defined(CONFIG_MQTT_BATCH)
+static size_t drain_channel;    /* Next channel of the reading at drain_pos */
+static struct drain_flight *drain_flight_cur;  /* Its flight, once opened */
+#endif
 
-    snprintf(buf, sizeof(buf), "%u:%02u:%02u.%03u", h, min, s, ms);
-    return buf;
+static struct drain_flight *drain_flight_at(size_t i)
+{
+    return &drain_flights[(drain_flight_first + i) % ARRAY_SIZE(drain_flights)];
 }
 
-void main(void)
+/* Track the readings before queue position 'end'; NULL when full */
+static struct drain_flight *drain_flight_open(uint32_t end)
 {
-    const struct device *const dht22 = DEVICE_DT_GET_ONE(aosong_dht);
+    struct drain_flight *flight;
 
-    if (!device_is_ready(dht22))
+    if (drain_flight_count == ARRAY_SIZE(drain_flights))
     {
-        printf("Device %s is not ready\n", dht22->name);
-        printf("Exiting application...\n");
-        return;
+        return NULL;
     }
 
-    const struct device *const gpio_dev = DEVICE_DT_GET(GPIO_NODE);
+    flight = drain_flight_at(drain_flight_count++);
+    flight->end = end;
+    flight->unacked = 0U;
+    flight->written = false;
+
+    return flight;
+}
 
-    if (!device_is_ready(gpio_dev))
+/* Pop the readings of the oldest flights that are completely done */
+static void drain_retire(void)
+{
+    struct drain_flight *flight;
+
+    while (drain_flight_count > 0U)
     {
-        printk("Device %s not ready!\n", gpio_dev->name);
-        printf("Exiting application...\n");
-        return;
+        flight = drain_flight_at(0);
+        if (!flight->written || (flight->unacked > 0U))
+        {
+            break;
+        }
+
+        store_forward_pop_through(flight->end);
+        drain_flight_first = (drain_flight_first + 1) % ARRAY_SIZE(drain_flights);
+        drain_flight_count--;
+    }
+}
+
+/* mqtt_set_ack_handler() callback; runs in mqtt_input() on this thread */
+static void drain_acked(uint32_t end)
+{
+    struct drain_flight *flight;
+
+    for (size_t i = 0; i < drain_flight_count; i++)
+    {
+        flight = drain_flight_at(i);
+        if ((flight->end == end) && (flight->unacked > 0U))
+        {
+            flight->unacked--;
+            break;
+        }
+    }
+
+    drain_retire();
+}
+
+/* Readings dropped on overflow take their queue positions with them */
+static void drain_sync(void)
+{
+    uint32_t first = store_forward_position();
+
+    if ((int32_t)(first - drain_pos) > 0)
+    {
+        drain_pos = first;
+#if !defined(CONFIG_MQTT_BATCH)
+        /* A half-written reading that was dropped is done with */
+        if (drain_flight_cur != NULL)
+        {
+            drain_flight_cur->written = true;
+            drain_flight_cur = NULL;
+        }
+        drain_channel = 0;
+#endif
+        drain_retire();
+    }
+}
+
+/* True while queued readings have not been sent yet */
+static bool drain_pending(void)
+{
+    struct sample_record record;
+
+    drain_sync();
+
+    return store_forward_peek_at(drain_pos, &record, 1) == 1U;
+}
+
+/* The message can never fit the MQTT buffers; resending will not help */
+static bool publish_too_big(int rc)
+{
+    return (rc == -EMSGSIZE) || (rc == -ENOMEM);
+}
+
+#if !defined(CONFIG_MQTT_BATCH)
+/* Publish the reading at drain_pos, one topic per registered channel:
+ * > 0 sent, 0 nothing to send or window full, < 0 link error. After a
+ * full window or a link error, the next call resumes at the channel
+ * that failed; a value too big to send is logged and dropped.
+ * Acknowledgements are not waited for here; the in-flight window holds
+ * the messages until they arrive.
+ */
+static int publish_record(void)
+{
+    /* Same six decimals "%f" used to give, without any floating point */
+    char valueBuffer2[16];
+    struct sample_record record;
+    struct drain_flight *flight = drain_flight_cur;
+    uint32_t start;
+    int result2 = -1;
+
+    if (mqtt_inflight_count() + RECORD_INFLIGHT_SLOTS > APP_MQTT_INFLIGHT_MAX)
+    {
+        return 0;   /* Window full; wait for acknowledgements first */
+    }
+
+    if (store_forward_peek_at(drain_pos, &record, 1) != 1U)
+    {
+        return 0;
+    }
+
+    if ((flight == NULL) && (drain_flight_count == ARRAY_SIZE(drain_flights)))
+    {
+        return 0;
+    }
+
+    for (; drain_channel < ARRAY_SIZE(sensor_registry); drain_channel++)
+    {
+        if (!(record.valid & BIT(drain_channel)))
+        {
+            continue;   /* Its sensor failed; nothing to send */
+        }
+
+        start = latency_start();
+        sensor_value_format(valueBuffer2, sizeof(valueBuffer2),
+                            &record.value[drain_channel], 6);
+        latency_stop(LATENCY_FORMAT, start);
+
+        result2 = publish_data(&client_ctx, sensor_registry[drain_channel].topic,
+                               sensor_registry[drain_channel].qos,
+                               (uint8_t *)valueBuffer2, strlen(valueBuffer2),
+                               drain_pos + 1);
+        PRINT_RESULT("mqtt_publish", result2);
+        if (result2 == -EAGAIN)
+        {
+            return 0;   /* Window full; resume at this channel */
+        }
+        if (!publish_too_big(result2))
+        {
+            SUCCESS_OR_RETURN(result2);
+        }
+
+        /* The flight opens with the first flow that is done with */
+        if (flight == NULL)
+        {
+            flight = drain_flight_open(drain_pos + 1);
+            drain_flight_cur = flight;
+        }
+
+        if (result2 != 0)
+        {
+            LOG_WRN("Dropped %s reading: %d",
+                    sensor_registry[drain_channel].topic, result2);
+        }
+        else if (sensor_registry[drain_channel].qos != MQTT_QOS_0_AT_MOST_ONCE)
+        {
+            flight->unacked++;
+        }
+    }
+
+    if (flight == NULL)
+    {
+        flight = drain_flight_open(drain_pos + 1);
+    }
+    flight->written = true;
+    drain_flight_cur = NULL;
+    drain_channel = 0;
+    drain_pos++;
+    drain_retire();
+
+    return 1;
+}
+#endif
+
+#if defined(CONFIG_MQTT_BATCH)
+BUILD_ASSERT(PAYLOAD_CODEC_MAX_SIZE(CONFIG_MQTT_BATCH_SIZE) + 64 <= APP_MQTT_BUFFER_SIZE,
+             "MQTT tx buffer too small for a full batch");
+
+/* Set while full batches may still be queued behind the last one sent */
+static bool drain_backlog;
+
+/* Publish the readings from drain_pos on as one batch once it is full,
+ * once its oldest reading has waited CONFIG_MQTT_BATCH_FLUSH_MS, or on
+ * 'flush'. A batch that cannot be encoded or sent whole is logged and
+ * its readings dropped.
+ */
+static int publish_batch(bool flush)
+{
+    static struct sample_record batch[CONFIG_MQTT_BATCH_SIZE];
+    static uint8_t payload[PAYLOAD_CODEC_MAX_SIZE(CONFIG_MQTT_BATCH_SIZE)];
+    struct drain_flight *flight;
+    size_t count;
+    int64_t age;
+    uint32_t start;
+    int len;
+    int result2 = -1;
+
+    if (((NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_BATCH_QOS != 0) &&
+         (mqtt_inflight_count() >= APP_MQTT_INFLIGHT_MAX)) ||
+        (drain_flight_count == ARRAY_SIZE(drain_flights)))
+    {
+        return 0;   /* Window full; wait for acknowledgements first */
+    }
+
+    count = store_forward_peek_at(drain_pos, batch, ARRAY_SIZE(batch));
+    drain_backlog = (count == ARRAY_SIZE(batch));
+
+    /* A reading from before a reboot may look younger than it is, or
+     * even lie in the future; treat it as overdue.
+     */
+    age = (count > 0U) ? (k_uptime_get() - batch[0].timestamp) : 0;
+    if ((count == 0U) || (!drain_backlog && !flush && (age >= 0) &&
+        (age < CONFIG_MQTT_BATCH_FLUSH_MS)))
+    {
+        return 0;
+    }
+
+    start = latency_start();
+    len = payload_encode_batch(payload, sizeof(payload), batch, count);
+    latency_stop(LATENCY_FORMAT, start);
+    if (len < 0)
+    {
+        result2 = len;
+    }
+    else
+    {
+        result2 = publish_data(&client_ctx, NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_BATCH,
+                               NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_BATCH_QOS,
+                               payload, len, drain_pos + count);
+        PRINT_RESULT("mqtt_publish batch", result2);
+        if (result2 == -EAGAIN)
+        {
+            return 0;   /* Window full; wait for acknowledgements first */
+        }
+        if (!publish_too_big(result2))
+        {
+            SUCCESS_OR_RETURN(result2);
+        }
+    }
+
+    if (result2 != 0)
+    {
+        LOG_WRN("Dropped batch of %zu readings: %d", count, result2);
+    }
+
+    /* The in-flight window now holds a copy; the queue keeps the
+     * readings until it is acknowledged.
+     */
+    flight = drain_flight_open(drain_pos + count);
+    flight->unacked = (result2 == 0) &&
+        (NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_BATCH_QOS != MQTT_QOS_0_AT_MOST_ONCE);
+    flight->written = true;
+    drain_pos += count;
+    drain_retire();
+
+    return count;
+}
+#endif
+
+#if defined(CONFIG_WINDOW_STATS)
+/* Every good sample feeds the open window; only the last closed window
+ * waits for the broker, an older unsent one is overwritten.
+ */
+static struct window_stats window[SENSOR_REGISTRY_COUNT];
+static struct window_summary window_closed[SENSOR_REGISTRY_COUNT];
+static int64_t window_start;
+static bool window_open;
+static bool window_pending;
+
+static void window_add(const struct sample_record *record)
+{
+    if (!window_open)
+    {
+        window_start = record->timestamp;
+        window_open = true;
+    }
+
+    /* A channel whose sensor kept failing reports "n":0 */
+    for (size_t i = 0; i < ARRAY_SIZE(window); i++)
+    {
+        if (record->valid & BIT(i))
+        {
+            window_stats_add(&window[i], sensor_value_to_centi(&record->value[i]));
+        }
+    }
+
+    if ((record->timestamp - window_start) >= CONFIG_WINDOW_STATS_PERIOD_MS)
+    {
+        for (size_t i = 0; i < ARRAY_SIZE(window); i++)
+        {
+            window_stats_summary(&window[i], &window_closed[i]);
+            window_stats_reset(&window[i]);
+        }
+        window_open = false;
+        window_pending = true;
+    }
+}
+
+/* A summary is pipelined like a reading, so an in-flight slot must hold it */
+BUILD_ASSERT(WINDOW_SUMMARY_SIZE <= APP_MQTT_PAYLOAD_SIZE,
+             "In-flight slot too small for a window summary");
+
+/* Publish the last closed window: > 0 sent, 0 nothing due, < 0 link error */
+static int publish_window(void)
+{
+    char payload[WINDOW_SUMMARY_SIZE];
+    int result2;
+
+    if (!window_pending ||
+        (mqtt_inflight_count() + RECORD_INFLIGHT_SLOTS > APP_MQTT_INFLIGHT_MAX))
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(sensor_registry); i++)
+    {
+        window_summary_format(payload, sizeof(payload), &window_closed[i]);
+
+        result2 = publish(&client_ctx, sensor_registry[i].stats_topic,
+                          sensor_registry[i].qos, payload);
+        PRINT_RESULT("mqtt_publish stats", result2);
+        if (result2 == -EAGAIN)
+        {
+            return 0;   /* Window full; the window is sent again */
+        }
+        if (publish_too_big(result2))
+        {
+            LOG_WRN("Dropped %s window: %d", sensor_registry[i].stats_topic,
+                    result2);
+            continue;
+        }
+        SUCCESS_OR_RETURN(result2);
+    }
+
+    window_pending = false;
+
+    return 1;
+}
+#endif
+
+#if defined(CONFIG_LATENCY_STATS_PUBLISH)
+static int64_t metrics_due;
+
+/* Publish the latency histograms every CONFIG_LATENCY_STATS_PUBLISH_MS:
+ * > 0 sent, 0 nothing due, < 0 link error. QoS 0, as the next report
+ * supersedes a lost one anyway.
+ */
+static int publish_metrics(void)
+{
+    static char payload[APP_MQTT_METRICS_SIZE];
+    int result2;
+
+    if ((k_uptime_get() < metrics_due) ||
+        (latency_format(payload, sizeof(payload)) < 0))
+    {
+        return 0;
+    }
+
+    result2 = publish(&client_ctx, NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC_METRICS,
+                      MQTT_QOS_0_AT_MOST_ONCE, payload);
+    PRINT_RESULT("mqtt_publish metrics", result2);
+    if (result2 == -EAGAIN)
+    {
+        return 0;
+    }
+    if (publish_too_big(result2))
+    {
+        LOG_WRN("Dropped metrics report: %d", result2);
+    }
+    else
+    {
+        SUCCESS_OR_RETURN(result2);
     }
 
-    /* Setup GPIO output to the LCD16x2 */
-    GPIO_PIN_CFG(gpio_dev, GPIO_PIN_E,  GPIO_OUTPUT);
-    GPIO_PIN_CFG(gpio_dev, GPIO_PIN_RS, GPIO_OUTPUT);
-    GPIO_PIN_CFG(gpio_dev, GPIO_PIN_D4, GPIO_OUTPUT);
-    GPIO_PIN_CFG(gpio_dev, GPIO_PIN_D5, GPIO_OUTPUT);
-    GPIO_PIN_CFG(gpio_dev, GPIO_PIN_D6, GPIO_OUTPUT);
-    GPIO_PIN_CFG(gpio_dev, GPIO_PIN_D7, GPIO_OUTPUT);
-    
-    int result = -1;
+    metrics_due = k_uptime_get() + CONFIG_LATENCY_STATS_PUBLISH_MS;
+
+    return 1;
+}
+#endif
+
+/* Publish the next due readings: > 0 sent, 0 nothing due, < 0 link error.
+ * 'flush' sends even a batch that is neither full nor old enough.
+ */
+static int drain_step(bool flush)
+{
+    drain_sync();
+
+#if defined(CONFIG_MQTT_BATCH)
+    return publish_batch(flush);
+#else
+    ARG_UNUSED(flush);
+
+    return publish_record();
+#endif
+}
+
+/* Milliseconds until drain_step() is worth calling, or SYS_FOREVER_MS */
+static int32_t drain_next_ms(void)
+{
+    if (!drain_pending())
+    {
+        return SYS_FOREVER_MS;
+    }
 
-    LOG_INF("Attempting to connect: ");
-    result = try_to_connect(&client_ctx);
-    PRINT_RESULT("try_to_connect", result);
-    SUCCESS_OR_EXIT(result);
+#if defined(CONFIG_MQTT_BATCH)
+    struct sample_record oldest;
 
-    printk("LCD Init\n");
-    pi_lcd_init(gpio_dev, 16, 2, LCD_5x8_DOTS);
+    if (!drain_backlog && (store_forward_peek_at(drain_pos, &oldest, 1) == 1U))
+    {
+        return CLAMP(CONFIG_MQTT_BATCH_FLUSH_MS -
+                     (k_uptime_get() - oldest.timestamp),
+                     0, CONFIG_MQTT_BATCH_FLUSH_MS);
+    }
+#endif
+
+    return CONFIG_STORE_FORWARD_DRAIN_INTERVAL_MS;
+}
+
+#if defined(CONFIG_APP_DUTY_CYCLE)
+/* Milliseconds until anything needs the broker link, or SYS_FOREVER_MS */
+static int32_t publish_due_ms(bool flush)
+{
+    int32_t due_ms = flush ? 0 : drain_next_ms();
+
+#if defined(CONFIG_MQTT_BATCH)
+    struct sample_record last;
+
+    /* A full batch is due at once, a partial one at its flush deadline */
+    if (store_forward_peek_at(drain_pos + CONFIG_MQTT_BATCH_SIZE - 1, &last, 1) == 1U)
+    {
+        due_ms = 0;
+    }
+#else
+    /* A queued reading is due at once */
+    if (due_ms != SYS_FOREVER_MS)
+    {
+        due_ms = 0;
+    }
+#endif
+#if defined(CONFIG_WINDOW_STATS)
+    if (window_pending)
+    {
+        due_ms = 0;
+    }
+#endif
+#if defined(CONFIG_LATENCY_STATS_PUBLISH)
+    int32_t metrics_ms = CLAMP(metrics_due - k_uptime_get(), 0,
+                               CONFIG_LATENCY_STATS_PUBLISH_MS);
+
+    due_ms = (due_ms == SYS_FOREVER_MS) ? metrics_ms : MIN(due_ms, metrics_ms);
+#endif
+
+    return due_ms;
+}
+#endif
+
+/* Called from the sampler thread; just ring the main loop's doorbell */
+static void on_sample(void)
+{
+    app_event_raise(APP_EVENT_SAMPLE);
+}
+
+/* Every enabled "nuertey,lcd16x2" node; all show the same readings */
+#define APP_LCD_DEVICE(node)    DEVICE_DT_GET(node),
+
+static const struct device *const app_lcds[] =
+{
+    DT_FOREACH_STATUS_OKAY(nuertey_lcd16x2, APP_LCD_DEVICE)
+};
+
+BUILD_ASSERT(ARRAY_SIZE(app_lcds) >= 1, "No nuertey,lcd16x2 node enabled");
+
+void main(void)
+{
+    /* Pins are configured and the panels initialized by the driver */
+    size_t p;
+
+    for (p = 0; p < ARRAY_SIZE(app_lcds); p++)
+    {
+        if (!device_is_ready(app_lcds[p]))
+        {
+            printk("Device %s not ready!\n", app_lcds[p]->name);
+            printf("Exiting application...\n");
+            return;
+        }
+    }
 
     printk("Outputting initial LCD16x2 welcome message...\n");
 
-    /* Clear display */
-    pi_lcd_clear(gpio_dev);
-    pi_lcd_set_cursor(gpio_dev, 0, 0);
-    pi_lcd_string(gpio_dev, "Nuertey Odzeyem");
-    pi_lcd_set_cursor(gpio_dev, 0, 1);
-    pi_lcd_string(gpio_dev, "NUCLEO F767ZI");
+    /* Init has already cleared the displays, so just draw the frames */
+    for (p = 0; p < ARRAY_SIZE(app_lcds); p++)
+    {
+        pi_lcd_frame_clear(app_lcds[p]);
+        pi_lcd_frame_string(app_lcds[p], 0, 0, "Nuertey Odzeyem");
+        pi_lcd_frame_string(app_lcds[p], 0, 1, "NUCLEO F767ZI");
+        pi_lcd_commit(app_lcds[p]);
+    }
     k_msleep(MSEC_PER_SEC * 5U);
 
+    for (p = 0; p < ARRAY_SIZE(app_lcds); p++)
+    {
+        /* Uploaded once; CGRAM is only rewritten if the glyph set changes */
+        lcd_trend_glyphs_load(app_lcds[p]);
+
+        /* From now on only its render thread touches the display */
+        lcd_render_start(app_lcds[p]);
+    }
+    display_start(app_lcds, ARRAY_SIZE(app_lcds));
+
+    /* Readings wait here whenever the broker cannot be reached */
+    if (store_forward_init() != 0)
+    {
+        printf("Store-and-forward limited to RAM\n");
+    }
+
+    /* Sampling runs on its own timer; this loop only consumes readings */
+    struct sampler_reader reader;
+    struct sample_record record;
+#if defined(CONFIG_REPORT_POLICY)
+    struct report_policy policy;
+#endif
+    struct zsock_pollfd events[2];
+    enum app_command cmd;
+    uint32_t pending;
+    int32_t wait_ms;
+    int32_t drain_ms;
+#if defined(CONFIG_APP_DUTY_CYCLE)
+    int32_t due_ms;
+#endif
+#if defined(CONFIG_LATENCY_STATS_PUBLISH)
+    int32_t metrics_ms;
+#endif
+    bool flush = false;
+    int rc;
+    int i;
+
+#if defined(CONFIG_REPORT_POLICY)
+    report_policy_init(&policy);
+#endif
+
+    if (app_event_init() != 0)
+    {
+        printf("Event doorbell unavailable\n");
+        printf("Exiting application...\n");
+        return;
+    }
+
+    sampler_reader_init(&reader);
+    sampler_set_notify(on_sample);
+    mqtt_set_ack_handler(drain_acked);
+    if (sampler_start() != 0)
+    {
+        printf("Exiting application...\n");
+        return;
+    }
+
+    /* One loop, one wait: new samples and commands (via the doorbell),
+     * broker traffic (via the MQTT socket) and the deadlines of the
+     * connection manager, keepalive, retransmits and backlog drain all
+     * wake the same zsock_poll(). The broker connection is made, and
+     * remade, by the connection manager; sampling never waits for it.
+     */
     while (true)
     {
-        int rc = sensor_sample_fetch(dht22);
+        mqtt_conn_step(&client_ctx);
 
-        if (rc != 0)
+        pending = app_event_take();
+
+        while ((pending & APP_EVENT_COMMAND) && (app_command_get(&cmd) == 0))
         {
-            printf("DHT11 Sensor fetch failed: %d\n", rc);
-            printf("Exiting application...\n");
-            break;
+            if (cmd == APP_CMD_FLUSH)
+            {
+                flush = true;
+            }
+            else if ((cmd == APP_CMD_RECONNECT) && mqtt_is_connected())
+            {
+                mqtt_abort(&client_ctx);
+            }
+        }
+
+        while ((pending & APP_EVENT_SAMPLE) &&
+               (sampler_read(&reader, &record, K_NO_WAIT) == 0))
+        {
+            if (record.status != 0)
+            {
+                printf("[%s]: Sensor read failed: %d\n",
+                       now_str(record.timestamp), record.status);
+            }
+            if (record.valid == 0U)
+            {
+                continue;
+            }
+
+            char line[32 * SENSOR_REGISTRY_COUNT];
+            char valueBuffer[16];
+            uint32_t start = latency_start();
+            size_t len = 0;
+
+            for (size_t c = 0; c < ARRAY_SIZE(sensor_registry); c++)
+            {
+                if (record.valid & BIT(c))
+                {
+                    sensor_value_format(valueBuffer, sizeof(valueBuffer),
+                                        &record.value[c], 2);
+                }
+                else
+                {
+                    strcpy(valueBuffer, "--");
+                }
+                len += snprintf(&line[len], sizeof(line) - len, "%s %s %s",
+                                (c == 0) ? "" : " ;", valueBuffer,
+                                sensor_registry[c].unit);
+                len = MIN(len, sizeof(line) - 1);
+            }
+            latency_stop(LATENCY_FORMAT, start);
+
+            printf("[%s]:%s\n", now_str(record.timestamp), line);
+
+#if defined(CONFIG_WINDOW_STATS)
+            window_add(&record);
+#endif
+
+#if defined(CONFIG_REPORT_POLICY)
+            /* Steady readings stay local; swings are sampled faster */
+            if (report_policy_update(&policy, &record))
+            {
+                store_forward_put(&record);
+            }
+            sampler_set_period(report_policy_period_ms(&policy));
+#else
+            store_forward_put(&record);
+#endif
         }
 
-        struct sensor_value temperature;
-        struct sensor_value humidity;
+#if defined(CONFIG_APP_DUTY_CYCLE)
+        /* Park the link when nothing is due within the linger, such as
+         * a batch still filling up, and wake it only once something is
+         * due; a resume moves the connection manager straight on to
+         * reconnecting.
+         */
+        due_ms = publish_due_ms(flush);
+        if ((mqtt_inflight_count() == 0U) && (due_ms != 0) &&
+            (duty_cycle_is_asleep() || (due_ms == SYS_FOREVER_MS) ||
+             (due_ms > CONFIG_APP_DUTY_CYCLE_LINGER_MS)))
+        {
+            duty_cycle_idle(&client_ctx);
+        }
+        else
+        {
+            duty_cycle_busy();
+        }
+#endif
 
-        rc = sensor_channel_get(dht22, SENSOR_CHAN_AMBIENT_TEMP, &temperature);
-        if (rc == 0)
+        if (mqtt_conn_state() == MQTT_CONN_CONNECTED)
         {
-            rc = sensor_channel_get(dht22, SENSOR_CHAN_HUMIDITY, &humidity);
-            if (rc != 0)
+            /* Oldest first, a bounded burst per wake-up, pipelined:
+             * acknowledgements wake this loop through the socket and
+             * free the window for the next burst.
+             */
+            rc = 0;
+#if defined(CONFIG_WINDOW_STATS)
+            rc = publish_window();
+#endif
+#if defined(CONFIG_LATENCY_STATS_PUBLISH)
+            if (rc >= 0)
+            {
+                rc = publish_metrics();
+            }
+#endif
+            for (i = 0; (rc >= 0) && (i < CONFIG_STORE_FORWARD_DRAIN_BURST); i++)
             {
-                printf("Sensor humidity retrieval failed: %d\n", rc);
-                printf("Exiting application...\n");
-                break;              
+                rc = drain_step(flush);
+                if (rc <= 0)
+                {
+                    break;
+                }
+            }
+
+            if (rc < 0)
+            {
+                /* Only a transport error gets here; a full window or
+                 * an oversized message is handled by the publisher.
+                 * Keep the readings queued; the abort hands the link
+                 * back to the connection manager.
+                 */
+                mqtt_abort(&client_ctx);
+            }
+            else
+            {
+                /* A flush lasts until the backlog is sent */
+                flush = flush && drain_pending();
             }
         }
-        else 
+
+        /* Sleep until the earliest deadline or any event */
+        wait_ms = mqtt_conn_next_ms(&client_ctx);
+        if (mqtt_conn_state() == MQTT_CONN_CONNECTED)
         {
-            printf("Sensor ambient temperature retrieval failed: %d\n", rc);
-            printf("Exiting application...\n");
-            break;
+            drain_ms = flush ? 0 : drain_next_ms();
+#if defined(CONFIG_LATENCY_STATS_PUBLISH)
+            metrics_ms = CLAMP(metrics_due - k_uptime_get(), 0,
+                               CONFIG_LATENCY_STATS_PUBLISH_MS);
+            drain_ms = (drain_ms == SYS_FOREVER_MS) ? metrics_ms :
+                       MIN(drain_ms, metrics_ms);
+#endif
+            if ((wait_ms == SYS_FOREVER_MS) ||
+                ((drain_ms != SYS_FOREVER_MS) && (drain_ms < wait_ms)))
+            {
+                wait_ms = drain_ms;
+            }
+        }
+#if defined(CONFIG_APP_DUTY_CYCLE)
+        /* Asleep, only the next due publish ends the wait */
+        drain_ms = duty_cycle_is_asleep() ? publish_due_ms(flush) :
+                   duty_cycle_next_ms();
+        if ((wait_ms == SYS_FOREVER_MS) ||
+            ((drain_ms != SYS_FOREVER_MS) && (drain_ms < wait_ms)))
+        {
+            wait_ms = drain_ms;
         }
+#endif
 
-        printf("[%s]: %.2f °C ; %.2f %%RH\n", now_str(), sensor_value_to_double(&temperature),
-            sensor_value_to_double(&humidity));
-            
-        char tempBuffer[16];
-        char humiBuffer[16];
-        char tempBuffer2[100];
-        char humiBuffer2[100];
-        snprintf(tempBuffer, sizeof(tempBuffer), "%.2f °C", sensor_value_to_double(&temperature));
-        snprintf(humiBuffer, sizeof(humiBuffer), "%.2f %%RH", sensor_value_to_double(&humidity));
-        snprintf(tempBuffer2, sizeof(tempBuffer2), "%f", sensor_value_to_double(&temperature));
-        snprintf(humiBuffer2, sizeof(humiBuffer2), "%f", sensor_value_to_double(&humidity));
-
-        pi_lcd_clear(gpio_dev);
-        pi_lcd_set_cursor(gpio_dev, 0, 0);
-        pi_lcd_string(gpio_dev, tempBuffer);
-        pi_lcd_set_cursor(gpio_dev, 0, 1);
-        pi_lcd_string(gpio_dev, humiBuffer);
-        
-        int result2 = -1;
-        
-        result2 = publish(&client_ctx, NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC1, tempBuffer2);
-        PRINT_RESULT("mqtt_publish temperature", result2);
-        SUCCESS_OR_BREAK(result2);
-
-        result2 = process_mqtt_and_sleep(&client_ctx, APP_SLEEP_MSECS);
-        SUCCESS_OR_BREAK(result2);
-
-        result2 = publish(&client_ctx, NUCLEO_F767ZI_DHT11_IOT_MQTT_TOPIC2, humiBuffer2);
-        PRINT_RESULT("mqtt_publish humidity", result2);
-        SUCCESS_OR_BREAK(result2);
-
-        result2 = process_mqtt_and_sleep(&client_ctx, APP_SLEEP_MSECS);
-        SUCCESS_OR_BREAK(result2);
-            
-        k_sleep(K_SECONDS(300)); // 5 minutes is reasonable for any discernable change.
-    }
-    
-    result = mqtt_disconnect(&client_ctx);
-    PRINT_RESULT("mqtt_disconnect", result);
-
-    LOG_INF("Bye!");
+        events[0].fd = app_event_fd();
+        events[0].events = ZSOCK_POLLIN;
+        events[1].fd = mqtt_conn_fd();
+        events[1].events = ZSOCK_POLLIN;
+
+        rc = zsock_poll(events, (events[1].fd >= 0) ? 2 : 1, wait_ms);
+        if (rc < 0)
+        {
+            LOG_ERR("poll error: %d", errno);
+            k_msleep(APP_CONNECT_POLL_MS);
+        }
+    }
 }
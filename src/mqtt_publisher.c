@@ -87,9 +87,78 @@ int wait(int timeout)
     return ret;
 }
 
+/* Outstanding QoS 1/2 publishes, keyed by message ID. Each slot keeps its
+ * own payload copy, so callers may reuse their buffers straight away and
+ * the message can still be retransmitted later.
+ */
+struct mqtt_inflight
+{
+    uint16_t message_id;        /* 0 marks a free slot */
+    uint8_t qos;
+    bool released;              /* QoS 2: PUBREC seen, waiting for PUBCOMP */
+    int64_t deadline;           /* Retransmit once reached */
+    int64_t sent;               /* Ticks at the first PUBLISH, for the RTT */
+    uint32_t tag;               /* Handed to the ack handler, 0 for none */
+    const char *topic;
+    size_t len;
+    uint8_t payload[APP_MQTT_PAYLOAD_SIZE];
+};
+
+static struct mqtt_inflight inflight[APP_MQTT_INFLIGHT_MAX];
+static struct mqtt_publish_stats publish_stats;
+static uint16_t last_message_id;
+static mqtt_ack_handler_t ack_handler;
+static int64_t wake_start;      /* Ticks at mqtt_conn_resume() */
+static bool wake_pending;       /* No PUBLISH written since the resume */
+
+static struct mqtt_inflight *inflight_find(uint16_t message_id)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(inflight); i++)
+    {
+        if ((message_id != 0U) && (inflight[i].message_id == message_id))
+        {
+            return &inflight[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Acknowledged: time the whole flow, free the slot, tell the owner */
+static void inflight_done(struct mqtt_inflight *slot)
+{
+    uint64_t rtt_us = k_ticks_to_us_floor64(k_uptime_ticks() - slot->sent);
+
+    latency_record_us((slot->qos == MQTT_QOS_2_EXACTLY_ONCE) ?
+                      LATENCY_RTT_QOS2 : LATENCY_RTT_QOS1,
+                      (uint32_t)MIN(rtt_us, UINT32_MAX));
+    slot->message_id = 0U;
+
+    if ((ack_handler != NULL) && (slot->tag != 0U))
+    {
+        ack_handler(slot->tag);
+    }
+}
+
+/* A PUBLISH reached the wire; time it and, after a resume, the wake */
+static void publish_written(uint32_t start)
+{
+    latency_stop(LATENCY_PUBLISH, start);
+    publish_stats.published++;
+
+    if (wake_pending)
+    {
+        uint64_t wake_us = k_ticks_to_us_floor64(k_uptime_ticks() - wake_start);
+
+        latency_record_us(LATENCY_WAKE, (uint32_t)MIN(wake_us, UINT32_MAX));
+        wake_pending = false;
+    }
+}
+
 void mqtt_evt_handler(struct mqtt_client *const client,
                       const struct mqtt_evt *evt)
 {
+    struct mqtt_inflight *slot;
     int err;
 
     switch (evt->type)
@@ -103,6 +172,10 @@ void mqtt_evt_handler(struct mqtt_client *const client,
 
         connected = true;
         LOG_INF("MQTT client connected!");
+#if defined(CONFIG_APP_DUTY_CYCLE)
+        LOG_INF("Broker session %s",
+                evt->param.connack.session_present_flag ? "resumed" : "new");
+#endif
 
         break;
 
@@ -123,6 +196,16 @@ void mqtt_evt_handler(struct mqtt_client *const client,
 
         LOG_INF("PUBACK packet id: %u", evt->param.puback.message_id);
 
+        slot = inflight_find(evt->param.puback.message_id);
+        if (slot != NULL)
+        {
+            inflight_done(slot);
+        }
+        else
+        {
+            publish_stats.dup_acks++;
+        }
+
         break;
 
     case MQTT_EVT_PUBREC:
@@ -134,6 +217,19 @@ void mqtt_evt_handler(struct mqtt_client *const client,
 
         LOG_INF("PUBREC packet id: %u", evt->param.pubrec.message_id);
 
+        /* From here on the PUBREL, not the PUBLISH, is what gets resent */
+        slot = inflight_find(evt->param.pubrec.message_id);
+        if ((slot == NULL) || slot->released)
+        {
+            /* Answer anyway, so the broker can finish its side */
+            publish_stats.dup_acks++;
+        }
+        else
+        {
+            slot->released = true;
+            slot->deadline = k_uptime_get() + APP_MQTT_RETRANSMIT_MS;
+        }
+
         const struct mqtt_pubrel_param rel_param =
         {
             .message_id = evt->param.pubrec.message_id
@@ -157,6 +253,16 @@ void mqtt_evt_handler(struct mqtt_client *const client,
         LOG_INF("PUBCOMP packet id: %u",
                 evt->param.pubcomp.message_id);
 
+        slot = inflight_find(evt->param.pubcomp.message_id);
+        if (slot != NULL)
+        {
+            inflight_done(slot);
+        }
+        else
+        {
+            publish_stats.dup_acks++;
+        }
+
         break;
 
     case MQTT_EVT_PINGRESP:
@@ -168,24 +274,212 @@ void mqtt_evt_handler(struct mqtt_client *const client,
     }
 }
 
-int publish(struct mqtt_client *client, char * topic, char * payload)
+int publish(struct mqtt_client *client, char * topic, enum mqtt_qos qos,
+            char * payload)
+{
+    return publish_data(client, topic, qos, (uint8_t *)payload, strlen(payload),
+                        0U);
+}
+
+/* Monotonic packet identifiers: skip 0, which is invalid and marks a free
+ * slot, and any ID whose QoS 1/2 flow is still open. With at most
+ * APP_MQTT_INFLIGHT_MAX IDs taken this terminates within that many steps.
+ */
+static uint16_t message_id_next(void)
+{
+    do
+    {
+        last_message_id++;
+    } while ((last_message_id == 0U) || (inflight_find(last_message_id) != NULL));
+
+    return last_message_id;
+}
+
+static int inflight_send(struct mqtt_client *client,
+                         const struct mqtt_inflight *slot, bool dup)
 {
     struct mqtt_publish_param param;
 
-    param.message.topic.qos = MQTT_QOS_2_EXACTLY_ONCE;
-    param.message.topic.topic.utf8 = (uint8_t *)topic;
-    param.message.topic.topic.size =
-        strlen(param.message.topic.topic.utf8);
-    param.message.payload.data = payload;
-    param.message.payload.len =
-        strlen(param.message.payload.data);
-    param.message_id = sys_rand32_get();
-    param.dup_flag = 0U;
+    if (slot->released)
+    {
+        const struct mqtt_pubrel_param rel_param =
+        {
+            .message_id = slot->message_id
+        };
+
+        return mqtt_publish_qos2_release(client, &rel_param);
+    }
+
+    param.message.topic.qos = slot->qos;
+    param.message.topic.topic.utf8 = (uint8_t *)slot->topic;
+    param.message.topic.topic.size = strlen(slot->topic);
+    param.message.payload.data = (uint8_t *)slot->payload;
+    param.message.payload.len = slot->len;
+    param.message_id = slot->message_id;
+    param.dup_flag = dup ? 1U : 0U;
     param.retain_flag = 0U;
 
     return mqtt_publish(client, &param);
 }
 
+/* Like publish(), for binary payloads that may contain NUL bytes. QoS 1/2
+ * messages are pipelined: this returns once the PUBLISH is written, and
+ * -EAGAIN while APP_MQTT_INFLIGHT_MAX messages await acknowledgement.
+ * A non-zero 'tag' goes to the mqtt_set_ack_handler() handler once the
+ * broker has acknowledged the message; QoS 0 messages are never acked.
+ */
+int publish_data(struct mqtt_client *client, char * topic, enum mqtt_qos qos,
+                 uint8_t * data, size_t len, uint32_t tag)
+{
+    struct mqtt_publish_param param;
+    struct mqtt_inflight *slot;
+    uint32_t start = latency_start();
+    int rc;
+
+    if (qos == MQTT_QOS_0_AT_MOST_ONCE)
+    {
+        param.message.topic.qos = qos;
+        param.message.topic.topic.utf8 = (uint8_t *)topic;
+        param.message.topic.topic.size =
+            strlen(param.message.topic.topic.utf8);
+        param.message.payload.data = data;
+        param.message.payload.len = len;
+        param.message_id = 0U;
+        param.dup_flag = 0U;
+        param.retain_flag = 0U;
+
+        rc = mqtt_publish(client, &param);
+        if (rc == 0)
+        {
+            publish_written(start);
+        }
+
+        return rc;
+    }
+
+    if (len > APP_MQTT_PAYLOAD_SIZE)
+    {
+        return -EMSGSIZE;
+    }
+
+    slot = NULL;
+    for (size_t i = 0; i < ARRAY_SIZE(inflight); i++)
+    {
+        if (inflight[i].message_id == 0U)
+        {
+            slot = &inflight[i];
+            break;
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return -EAGAIN;
+    }
+
+    slot->message_id = message_id_next();
+    slot->qos = qos;
+    slot->released = false;
+    slot->topic = topic;
+    slot->len = len;
+    memcpy(slot->payload, data, len);
+    slot->sent = k_uptime_ticks();
+    slot->tag = tag;
+
+    rc = inflight_send(client, slot, false);
+    if (rc != 0)
+    {
+        /* Never reached the wire; let the caller keep its copy */
+        slot->message_id = 0U;
+        return rc;
+    }
+
+    slot->deadline = k_uptime_get() + APP_MQTT_RETRANSMIT_MS;
+    publish_written(start);
+
+    return 0;
+}
+
+/** Call 'handler' with the tag of every acknowledged QoS 1/2 publish */
+void mqtt_set_ack_handler(mqtt_ack_handler_t handler)
+{
+    ack_handler = handler;
+}
+
+/** Copy out the publish counters; they only ever increase */
+void mqtt_publish_stats_get(struct mqtt_publish_stats *stats)
+{
+    *stats = publish_stats;
+}
+
+/** Number of QoS 1/2 publishes still awaiting acknowledgement */
+size_t mqtt_inflight_count(void)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < ARRAY_SIZE(inflight); i++)
+    {
+        if (inflight[i].message_id != 0U)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/* Resend whatever is due, or everything when 'all' is set (reconnect) */
+static int inflight_retransmit(struct mqtt_client *client, bool all)
+{
+    int64_t now = k_uptime_get();
+    int rc;
+
+    for (size_t i = 0; i < ARRAY_SIZE(inflight); i++)
+    {
+        struct mqtt_inflight *slot = &inflight[i];
+
+        if ((slot->message_id == 0U) || (!all && (now < slot->deadline)))
+        {
+            continue;
+        }
+
+        LOG_INF("Retransmit packet id: %u", slot->message_id);
+
+        rc = inflight_send(client, slot, true);
+        if (rc != 0)
+        {
+            PRINT_RESULT("mqtt retransmit", rc);
+            return rc;
+        }
+
+        slot->deadline = now + APP_MQTT_RETRANSMIT_MS;
+        publish_stats.retransmits++;
+    }
+
+    return 0;
+}
+
+/* Milliseconds until the next retransmit is due, or SYS_FOREVER_MS */
+static int32_t inflight_next_ms(void)
+{
+    int64_t next = INT64_MAX;
+
+    for (size_t i = 0; i < ARRAY_SIZE(inflight); i++)
+    {
+        if (inflight[i].message_id != 0U)
+        {
+            next = MIN(next, inflight[i].deadline);
+        }
+    }
+
+    if (next == INT64_MAX)
+    {
+        return SYS_FOREVER_MS;
+    }
+
+    return CLAMP(next - k_uptime_get(), 0, APP_MQTT_RETRANSMIT_MS);
+}
+
 void broker_init(void)
 {
 #if defined(CONFIG_NET_IPV6)
@@ -239,6 +533,12 @@ void client_init(struct mqtt_client *client)
     client->password = NULL;
     client->user_name = NULL;
     client->protocol_version = MQTT_VERSION_3_1_1;
+#if defined(CONFIG_APP_DUTY_CYCLE)
+    /* Keep the broker-side session, and its queued QoS 1/2 state, across
+     * suspends; the client ID above is fixed, so the broker can find it.
+     */
+    client->clean_session = 0U;
+#endif
 
     /* MQTT buffers configuration */
     client->rx_buf = rx_buffer;
@@ -290,80 +590,229 @@ void client_init(struct mqtt_client *client)
 #endif
 }
 
-/* In this routine we block until the connected variable is 1 */
-int try_to_connect(struct mqtt_client *client)
+/* 'connected' is static in the header, so other files must ask here */
+bool mqtt_is_connected(void)
+{
+    return connected;
+}
+
+/* Connection manager state; lives here, next to the static 'connected'
+ * flag the event handler maintains.
+ */
+static enum mqtt_conn_state conn_state = MQTT_CONN_DISCONNECTED;
+static bool conn_client_ready;  /* client_init() done, reuse on reconnect */
+static uint32_t conn_attempts;  /* Failed attempts since last success */
+static int64_t conn_deadline;   /* CONNECTING timeout or BACKOFF expiry */
+
+/* Jittered exponential backoff: a random delay in [d/2, d], where d
+ * doubles per failed attempt up to the configured maximum.
+ */
+static void conn_backoff(void)
 {
-    int rc, i = 0;
+    uint32_t delay = CONFIG_MQTT_BACKOFF_MIN_MS;
 
-    while (i++ < APP_CONNECT_TRIES && !connected)
+    /* Double per attempt, but stop at the maximum: shifting instead would
+     * wrap to 0 ms after about 30 attempts, right in a long outage.
+     */
+    for (uint32_t i = 0; (i < conn_attempts) &&
+         (delay < (uint32_t)CONFIG_MQTT_BACKOFF_MAX_MS); i++)
     {
-        client_init(client);
+        delay *= 2U;
+    }
+    delay = MIN(delay, (uint32_t)CONFIG_MQTT_BACKOFF_MAX_MS);
+    delay = (delay / 2U) + (sys_rand32_get() % ((delay / 2U) + 1U));
+
+    conn_attempts++;
+    conn_deadline = k_uptime_get() + delay;
+    conn_state = MQTT_CONN_BACKOFF;
+
+    LOG_INF("MQTT reconnect attempt %u in %u ms", conn_attempts, delay);
+}
+
+/** Advance the connection manager; never blocks beyond the TCP connect */
+void mqtt_conn_step(struct mqtt_client *client)
+{
+    int rc;
+
+    switch (conn_state)
+    {
+    case MQTT_CONN_DISCONNECTED:
+        /* Fast path: the client, its buffers and the broker address
+         * are set up once and reused for every reconnect.
+         */
+        if (!conn_client_ready)
+        {
+            client_init(client);
+            conn_client_ready = true;
+        }
 
         rc = mqtt_connect(client);
         if (rc != 0)
         {
             PRINT_RESULT("mqtt_connect", rc);
-            k_sleep(K_MSEC(APP_SLEEP_MSECS));
-            continue;
+            conn_backoff();
+            break;
         }
 
         prepare_fds(client);
+        conn_deadline = k_uptime_get() + APP_CONNECT_TIMEOUT_MS;
+        conn_state = MQTT_CONN_CONNECTING;
+        break;
 
-        if (wait(APP_CONNECT_TIMEOUT_MS))
+    case MQTT_CONN_CONNECTING:
+        if (wait(0) > 0)
         {
             mqtt_input(client);
         }
 
-        if (!connected)
+        if (connected)
+        {
+            conn_attempts = 0;
+            conn_state = MQTT_CONN_CONNECTED;
+
+            /* Whatever was unacknowledged when the link dropped */
+            if (inflight_retransmit(client, true) != 0)
+            {
+                mqtt_abort(client);
+            }
+        }
+        else if (k_uptime_get() >= conn_deadline)
         {
             mqtt_abort(client);
+            conn_backoff();
         }
-    }
+        break;
 
-    if (connected)
-    {
-        return 0;
+    case MQTT_CONN_CONNECTED:
+        /* Whatever the broker sent since the last step */
+        if (connected && (wait(0) > 0) && (mqtt_input(client) != 0))
+        {
+            mqtt_abort(client);
+        }
+
+        /* PINGREQ when the keepalive interval is up */
+        if (connected && (mqtt_keepalive_time_left(client) == 0))
+        {
+            rc = mqtt_live(client);
+            if ((rc != 0) && (rc != -EAGAIN))
+            {
+                PRINT_RESULT("mqtt_live", rc);
+                mqtt_abort(client);
+            }
+        }
+
+        if (connected && (inflight_retransmit(client, false) != 0))
+        {
+            mqtt_abort(client);
+        }
+
+        if (!connected)
+        {
+            /* First retry right away; the broker may just have bounced */
+            conn_state = MQTT_CONN_DISCONNECTED;
+        }
+        break;
+
+    case MQTT_CONN_BACKOFF:
+        if (k_uptime_get() >= conn_deadline)
+        {
+            conn_state = MQTT_CONN_DISCONNECTED;
+        }
+        break;
+
+    case MQTT_CONN_SUSPENDED:
+        /* Stays put until mqtt_conn_resume() */
+        break;
     }
+}
 
-    return -EINVAL;
+/** Socket to watch for broker traffic, or -1 while there is none */
+int mqtt_conn_fd(void)
+{
+    return (nfds > 0) ? fds[0].fd : -1;
 }
 
-int process_mqtt_and_sleep(struct mqtt_client *client, int timeout)
+/** Milliseconds until mqtt_conn_step() has work, or SYS_FOREVER_MS.
+ *  Incoming traffic on mqtt_conn_fd() is work too, whenever it comes.
+ */
+int32_t mqtt_conn_next_ms(const struct mqtt_client *client)
 {
-    int64_t remaining = timeout;
-    int64_t start_time = k_uptime_get();
-    int rc;
+    int32_t next;
+
+    int64_t remaining = conn_deadline - k_uptime_get();
 
-    while (remaining > 0 && connected)
+    switch (conn_state)
     {
-        if (wait(remaining))
-        {
-            rc = mqtt_input(client);
-            if (rc != 0)
-            {
-                PRINT_RESULT("mqtt_input", rc);
-                return rc;
-            }
-        }
+    case MQTT_CONN_DISCONNECTED:
+        return 0;
+
+    case MQTT_CONN_CONNECTING:
+        return CLAMP(remaining, 0, APP_CONNECT_POLL_MS);
+
+    case MQTT_CONN_BACKOFF:
+        return MAX(remaining, 0);
 
-        rc = mqtt_live(client);
-        if (rc != 0 && rc != -EAGAIN)
+    case MQTT_CONN_SUSPENDED:
+        return SYS_FOREVER_MS;
+
+    case MQTT_CONN_CONNECTED:
+    default:
+        if (!connected)
         {
-            PRINT_RESULT("mqtt_live", rc);
-            return rc;
+            return 0;
         }
-        else if (rc == 0)
+
+        next = inflight_next_ms();
+        if (client->keepalive != 0U)
         {
-            rc = mqtt_input(client);
-            if (rc != 0)
-            {
-                PRINT_RESULT("mqtt_input", rc);
-                return rc;
-            }
+            next = (next == SYS_FOREVER_MS) ? mqtt_keepalive_time_left(client) :
+                   MIN(next, mqtt_keepalive_time_left(client));
         }
+        return next;
+    }
+}
+
+enum mqtt_conn_state mqtt_conn_state(void)
+{
+    return conn_state;
+}
+
+/** Close the link ahead of a sleep. Unacknowledged QoS 1/2 messages stay
+ *  in flight and are resent once mqtt_conn_resume() has reconnected.
+ */
+void mqtt_conn_suspend(struct mqtt_client *client)
+{
+    if (conn_state == MQTT_CONN_SUSPENDED)
+    {
+        return;
+    }
 
-        remaining = timeout + start_time - k_uptime_get();
+    if (connected && (mqtt_disconnect(client) == 0))
+    {
+        LOG_INF("MQTT link suspended");
+    }
+    else if (conn_state == MQTT_CONN_CONNECTING || connected)
+    {
+        mqtt_abort(client);
     }
 
-    return 0;
+    connected = false;
+    clear_fds();
+    conn_state = MQTT_CONN_SUSPENDED;
+}
+
+/** Reconnect on the next mqtt_conn_step(), skipping any backoff, and time
+ *  the way to the first PUBLISH as the "wake" latency.
+ */
+void mqtt_conn_resume(void)
+{
+    if (conn_state != MQTT_CONN_SUSPENDED)
+    {
+        return;
+    }
+
+    conn_attempts = 0;
+    conn_state = MQTT_CONN_DISCONNECTED;
+    wake_start = k_uptime_ticks();
+    wake_pending = true;
 }
@@ -18,6 +18,7 @@
 
 #define SUCCESS_OR_EXIT(rc) { if (rc != 0) { return 1; } }
 #define SUCCESS_OR_BREAK(rc) { if (rc != 0) { break; } }
+#define SUCCESS_OR_RETURN(rc) { if (rc != 0) { return rc; } }
 
 #define RC_STR(rc) ((rc) == 0 ? "OK" : "ERROR")
 
@@ -87,6 +88,27 @@ static APP_BMEM bool connected;
     int tls_init(void);
 #endif /* CONFIG_MQTT_LIB_TLS */
 
+/* Non-blocking connection manager driven by mqtt_conn_step() */
+enum mqtt_conn_state
+{
+    MQTT_CONN_DISCONNECTED,     /* Ready to (re)connect right now */
+    MQTT_CONN_CONNECTING,       /* Waiting for CONNACK */
+    MQTT_CONN_CONNECTED,
+    MQTT_CONN_BACKOFF,          /* Waiting out a jittered retry delay */
+    MQTT_CONN_SUSPENDED,        /* Parked by mqtt_conn_suspend() */
+};
+
+/* Told the tag of each acknowledged publish_data() message */
+typedef void (*mqtt_ack_handler_t)(uint32_t tag);
+
+/* Publish path counters, see mqtt_publish_stats_get() */
+struct mqtt_publish_stats
+{
+    uint32_t published;         /* PUBLISH packets written, QoS 0 included */
+    uint32_t retransmits;       /* PUBLISH (DUP) or PUBREL resent */
+    uint32_t dup_acks;          /* Acks for IDs no longer, or never, in flight */
+};
+
 /******************************************
  * USER can use the APIs that follow below.
  *****************************************/ 
@@ -94,8 +116,19 @@ void prepare_fds(struct mqtt_client *client);
 void clear_fds(void);
 int wait(int timeout);
 void mqtt_evt_handler(struct mqtt_client *const client, const struct mqtt_evt *evt);
-int publish(struct mqtt_client *client, char * topic, char * payload);
+int publish(struct mqtt_client *client, char * topic, enum mqtt_qos qos,
+            char * payload);
+int publish_data(struct mqtt_client *client, char * topic, enum mqtt_qos qos,
+                 uint8_t * data, size_t len, uint32_t tag);
+void mqtt_set_ack_handler(mqtt_ack_handler_t handler);
+size_t mqtt_inflight_count(void);
+void mqtt_publish_stats_get(struct mqtt_publish_stats *stats);
 void broker_init(void);
 void client_init(struct mqtt_client *client);
-int try_to_connect(struct mqtt_client *client);
-int process_mqtt_and_sleep(struct mqtt_client *client, int timeout);
+bool mqtt_is_connected(void);
+void mqtt_conn_step(struct mqtt_client *client);
+int mqtt_conn_fd(void);
+int32_t mqtt_conn_next_ms(const struct mqtt_client *client);
+enum mqtt_conn_state mqtt_conn_state(void);
+void mqtt_conn_suspend(struct mqtt_client *client);
+void mqtt_conn_resume(void);
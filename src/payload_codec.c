@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "payload_codec.h"
+#include "value_format.h"
+
+struct payload_cursor
+{
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+};
+
+static void payload_put_uvar(struct payload_cursor *cur, uint64_t value)
+{
+    do
+    {
+        if (cur->len >= cur->size)
+        {
+            cur->overflow = true;
+            return;
+        }
+
+        cur->buf[cur->len] = value & 0x7F;
+        value >>= 7;
+        if (value != 0U)
+        {
+            cur->buf[cur->len] |= 0x80;
+        }
+        cur->len++;
+    } while (value != 0U);
+}
+
+static void payload_put_svar(struct payload_cursor *cur, int64_t value)
+{
+    /* Zigzag keeps small negative deltas small */
+    payload_put_uvar(cur, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static int payload_get_uvar(const uint8_t *buf, size_t len, size_t *pos,
+                            uint64_t *value)
+{
+    unsigned int shift = 0;
+
+    *value = 0;
+    while (*pos < len && shift < 64)
+    {
+        *value |= (uint64_t)(buf[*pos] & 0x7F) << shift;
+        if ((buf[(*pos)++] & 0x80) == 0U)
+        {
+            return 0;
+        }
+        shift += 7;
+    }
+
+    return -EINVAL;
+}
+
+static int payload_get_svar(const uint8_t *buf, size_t len, size_t *pos,
+                            int64_t *value)
+{
+    uint64_t raw;
+    int rc;
+
+    rc = payload_get_uvar(buf, len, pos, &raw);
+    *value = (int64_t)(raw >> 1) ^ -(int64_t)(raw & 1U);
+
+    return rc;
+}
+
+/** Encode up to 255 readings; returns the length or -ENOMEM */
+int payload_encode_batch(uint8_t *buf, size_t size,
+                         const struct sample_record *records, size_t count)
+{
+    struct payload_cursor cur = { .buf = buf, .size = size };
+    struct payload_reading prev = { 0 };
+    int32_t value;
+    size_t i;
+    size_t c;
+
+    if ((count == 0U) || (count > UINT8_MAX) || (size < 3U))
+    {
+        return -EINVAL;
+    }
+
+    cur.buf[cur.len++] = PAYLOAD_CODEC_VERSION;
+    cur.buf[cur.len++] = count;
+    cur.buf[cur.len++] = SENSOR_REGISTRY_COUNT;
+
+    for (i = 0; i < count; i++)
+    {
+        /* The first reading is absolute: its "previous" is all zeros */
+        payload_put_svar(&cur, records[i].timestamp - prev.timestamp);
+        prev.timestamp = records[i].timestamp;
+        payload_put_uvar(&cur, ~records[i].valid & SAMPLER_ALL_VALID);
+
+        for (c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+        {
+            if (!(records[i].valid & BIT(c)))
+            {
+                continue;
+            }
+
+            value = sensor_value_to_centi(&records[i].value[c]);
+            payload_put_svar(&cur, (int64_t)value - prev.value[c]);
+            prev.value[c] = value;
+        }
+    }
+
+    return cur.overflow ? -ENOMEM : (int)cur.len;
+}
+
+/** Reference decoder; returns the number of readings or -EINVAL */
+int payload_decode_batch(const uint8_t *buf, size_t len,
+                         struct payload_reading *readings, size_t max)
+{
+    struct payload_reading prev = { 0 };
+    uint64_t missing;
+    int64_t delta;
+    size_t pos = 3;
+    size_t count;
+    size_t i;
+    size_t c;
+
+    if ((len < 3U) || (buf[0] != PAYLOAD_CODEC_VERSION) ||
+        (buf[2] != SENSOR_REGISTRY_COUNT))
+    {
+        return -EINVAL;
+    }
+
+    count = buf[1];
+    if (count > max)
+    {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        if (payload_get_svar(buf, len, &pos, &delta) != 0)
+        {
+            return -EINVAL;
+        }
+        prev.timestamp += delta;
+
+        if ((payload_get_uvar(buf, len, &pos, &missing) != 0) ||
+            ((missing & ~(uint64_t)SAMPLER_ALL_VALID) != 0U))
+        {
+            return -EINVAL;
+        }
+        prev.valid = ~(uint32_t)missing & SAMPLER_ALL_VALID;
+
+        for (c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+        {
+            if (!(prev.valid & BIT(c)))
+            {
+                continue;
+            }
+
+            if (payload_get_svar(buf, len, &pos, &delta) != 0)
+            {
+                return -EINVAL;
+            }
+            prev.value[c] += delta;
+        }
+
+        readings[i] = prev;
+    }
+
+    return count;
+}
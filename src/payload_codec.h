@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Compact binary encoding of a batch of readings.
+ *
+ * Format (all integers are LEB128 varints; signed ones are
+ * zigzag-encoded first):
+ *
+ *     u8      version (PAYLOAD_CODEC_VERSION)
+ *     u8      count N (1..255)
+ *     u8      channels C, in sensor registry order
+ *     N times, each relative to the reading before it (reading 0 to
+ *     zeros):
+ *       svar  timestamp delta, ms of device uptime
+ *       uvar  mask of the channels missing from this reading
+ *       svar  value delta of each present channel, hundredths, against
+ *             the last reading that had the channel
+ *
+ * Timestamps are uptimes, and readings replayed from flash were taken
+ * before a reboot, so a delta can be negative.
+ *
+ * Steady readings taken a few seconds apart cost 5-6 bytes each, versus
+ * one MQTT PUBLISH flow carrying an ASCII "%f" string per channel.
+ */
+#pragma once
+
+#include "sampler.h"
+
+#define PAYLOAD_CODEC_VERSION          1
+
+/* Bytes of the missing-channel mask when every channel is missing */
+#define PAYLOAD_CODEC_MASK_SIZE        ((SENSOR_REGISTRY_COUNT + 6) / 7)
+
+/* Worst case: 3 header bytes, then 10 bytes of time, the mask and 5
+ * bytes per value
+ */
+#define PAYLOAD_CODEC_MAX_SIZE(n)                                       \
+    (3 + ((10 + PAYLOAD_CODEC_MASK_SIZE + (5 * SENSOR_REGISTRY_COUNT)) * (n)))
+
+struct payload_reading
+{
+    int64_t timestamp;      /* ms */
+    uint32_t valid;         /* Bit c set when value[c] was sent */
+    int32_t value[SENSOR_REGISTRY_COUNT];  /* hundredths */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int payload_encode_batch(uint8_t *buf, size_t size,
+                         const struct sample_record *records, size_t count);
+int payload_decode_batch(const uint8_t *buf, size_t len,
+                         struct payload_reading *readings, size_t max);
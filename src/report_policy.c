@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "report_policy.h"
+#include "value_format.h"
+#include <stdlib.h>
+
+/** Load the per-channel policy from the sensor registry and the global
+ *  intervals from Kconfig, and forget any previous report.
+ */
+void report_policy_init(struct report_policy *policy)
+{
+    memset(policy, 0, sizeof(*policy));
+
+    for (size_t i = 0; i < REPORT_CHAN_COUNT; i++)
+    {
+        policy->channel[i].abs_deadband = sensor_registry[i].deadband;
+        policy->channel[i].rel_deadband = sensor_registry[i].rel_deadband;
+        policy->channel[i].roc_per_min = sensor_registry[i].roc_per_min;
+    }
+
+    policy->min_interval_ms = CONFIG_REPORT_MIN_INTERVAL_MS;
+    policy->max_interval_ms = CONFIG_REPORT_MAX_INTERVAL_MS;
+    policy->period_ms = CONFIG_SAMPLER_PERIOD_MS;
+    policy->fast_period_ms = CONFIG_REPORT_FAST_PERIOD_MS;
+}
+
+static bool report_outside_deadband(const struct report_channel_policy *chan,
+                                    int32_t reported, int32_t value)
+{
+    int32_t delta = abs(value - reported);
+
+    if (delta > chan->abs_deadband)
+    {
+        return true;
+    }
+
+    return (chan->rel_deadband != 0U) &&
+           (((int64_t)delta * 1000) > ((int64_t)abs(reported) * chan->rel_deadband));
+}
+
+/** Feed one reading with at least one channel; returns true if it
+ *  should be published.
+ */
+bool report_policy_update(struct report_policy *policy,
+                          const struct sample_record *record)
+{
+    int32_t value[REPORT_CHAN_COUNT];
+    int64_t elapsed;
+    int64_t step_ms;
+    bool due;
+
+    for (size_t i = 0; i < REPORT_CHAN_COUNT; i++)
+    {
+        value[i] = sensor_value_to_centi(&record->value[i]);
+    }
+
+    /* Rate of change against the previous sample, in hundredths/minute */
+    policy->swinging = false;
+    step_ms = record->timestamp - policy->previous_ms;
+    if (step_ms > 0)
+    {
+        for (size_t i = 0; i < REPORT_CHAN_COUNT; i++)
+        {
+            int64_t rate = ((int64_t)abs(value[i] - policy->previous[i]) *
+                            60000) / step_ms;
+
+            if ((record->valid & policy->sampled & BIT(i)) &&
+                (policy->channel[i].roc_per_min != 0) &&
+                (rate >= policy->channel[i].roc_per_min))
+            {
+                policy->swinging = true;
+            }
+        }
+    }
+
+    memcpy(policy->previous, value, sizeof(value));
+    policy->previous_ms = record->timestamp;
+    policy->sampled = record->valid;
+
+    elapsed = record->timestamp - policy->last_report_ms;
+    if (!policy->reported || (elapsed >= policy->max_interval_ms))
+    {
+        due = true;
+    }
+    else if (elapsed < policy->min_interval_ms)
+    {
+        due = false;
+    }
+    else
+    {
+        due = false;
+        for (size_t i = 0; i < REPORT_CHAN_COUNT; i++)
+        {
+            if ((record->valid & BIT(i)) &&
+                report_outside_deadband(&policy->channel[i],
+                                        policy->last_report[i], value[i]))
+            {
+                due = true;
+            }
+        }
+    }
+
+    if (due)
+    {
+        for (size_t i = 0; i < REPORT_CHAN_COUNT; i++)
+        {
+            if (record->valid & BIT(i))
+            {
+                policy->last_report[i] = value[i];
+            }
+        }
+        policy->last_report_ms = record->timestamp;
+        policy->reported = true;
+    }
+
+    return due;
+}
+
+/** Sampling period the policy wants after the last update */
+uint32_t report_policy_period_ms(const struct report_policy *policy)
+{
+    return policy->swinging ? policy->fast_period_ms : policy->period_ms;
+}
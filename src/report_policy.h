@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Change-driven reporting policy between the sampler and MQTT.
+ *
+ * A reading is reported when a channel has moved beyond its deadband
+ * since the last report (absolute, or relative to the reported value),
+ * but never sooner than the minimum interval after the previous report.
+ * A reading is always reported once the maximum interval has passed,
+ * which doubles as a heartbeat. While any channel changes faster than
+ * its rate-of-change threshold, the policy asks for the fast sampling
+ * period; otherwise for the normal one. Channels missing from a reading
+ * take no part in its decision.
+ */
+#pragma once
+
+#include "sampler.h"
+
+/* One policy channel per sensor registry entry */
+#define REPORT_CHAN_COUNT       SENSOR_REGISTRY_COUNT
+
+struct report_channel_policy
+{
+    int32_t abs_deadband;       /* Hundredths, e.g. 50 = 0.5 degC */
+    uint32_t rel_deadband;      /* Per mille of the last report, 0 = off */
+    int32_t roc_per_min;        /* Hundredths per minute, 0 = off */
+};
+
+struct report_policy
+{
+    struct report_channel_policy channel[REPORT_CHAN_COUNT];
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;
+    uint32_t period_ms;         /* Sampling period when steady */
+    uint32_t fast_period_ms;    /* Sampling period while values swing */
+
+    /* State */
+    bool reported;              /* At least one report made */
+    uint32_t sampled;           /* Channels 'previous' holds a value of */
+    bool swinging;              /* Last step exceeded a rate threshold */
+    int64_t last_report_ms;
+    int64_t previous_ms;
+    int32_t last_report[REPORT_CHAN_COUNT];
+    int32_t previous[REPORT_CHAN_COUNT];
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void report_policy_init(struct report_policy *policy);
+bool report_policy_update(struct report_policy *policy,
+                          const struct sample_record *record);
+uint32_t report_policy_period_ms(const struct report_policy *policy);
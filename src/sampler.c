@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sampler.h"
+#include "sensor_acq.h"
+#include "value_format.h"
+#include <zephyr/sys/printk.h>
+
+#if defined(CONFIG_SENSOR_FILTER)
+#include "sensor_filter.h"
+#endif
+
+K_THREAD_STACK_DEFINE(sampler_stack, CONFIG_SAMPLER_STACK_SIZE);
+
+static struct k_thread sampler_thread;
+
+static struct sample_record sampler_ring[CONFIG_SAMPLER_RING_SIZE];
+static uint32_t sampler_head;  /* Sequence number of the next record */
+static K_MUTEX_DEFINE(sampler_lock);
+static K_CONDVAR_DEFINE(sampler_cond);
+
+static K_SEM_DEFINE(sampler_tick, 0, 1);
+
+static void sampler_timer_expiry(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+
+    k_sem_give(&sampler_tick);
+}
+
+static K_TIMER_DEFINE(sampler_timer, sampler_timer_expiry, NULL);
+static uint32_t sampler_period_ms = CONFIG_SAMPLER_PERIOD_MS;
+
+static sampler_notify_t sampler_notify;
+
+/* Only the sampler thread writes these word-sized counters */
+static struct sampler_stats sampler_counters;
+
+#if defined(CONFIG_SENSOR_FILTER)
+static struct sensor_filter sampler_filter[SENSOR_REGISTRY_COUNT];
+
+static void sampler_filter_value(struct sensor_filter *filter,
+                                 struct sensor_value *val)
+{
+    bool outlier;
+    int32_t centi = sensor_filter_apply(filter, sensor_value_to_centi(val),
+                                        &outlier);
+
+    if (outlier)
+    {
+        sampler_counters.outliers++;
+    }
+
+    val->val1 = centi / 100;
+    val->val2 = (centi % 100) * 10000;
+}
+#endif
+
+static void sampler_scale(struct sensor_value *val, int32_t scale)
+{
+    int64_t micro = ((int64_t)val->val1 * 1000000) + val->val2;
+
+    micro *= scale;
+    val->val1 = micro / 1000000;
+    val->val2 = micro % 1000000;
+}
+
+/* Index of the first registry entry using the same device as 'i' */
+static size_t sampler_first_of_device(size_t i)
+{
+    size_t j;
+
+    for (j = 0; j < i; j++)
+    {
+        if (sensor_registry[j].dev == sensor_registry[i].dev)
+        {
+            break;
+        }
+    }
+
+    return j;
+}
+
+static void sampler_fetch(struct sample_record *record, uint32_t seq)
+{
+    /* Fetch status per registry entry; only first-of-device ones used */
+    int status[SENSOR_REGISTRY_COUNT];
+    struct sensor_acq_req req;
+    size_t pending = 0;
+    size_t i;
+    int rc;
+
+    /* Take results that came in after an earlier sample gave up on
+     * them, so their devices can be submitted again.
+     */
+    while (sensor_acq_complete(&req, K_NO_WAIT) == 0)
+    {
+    }
+
+    record->timestamp = k_uptime_get();
+
+    /* Submit every distinct device at once; they are fetched in parallel.
+     * A device still busy with a fetch we gave up on is skipped for this
+     * sample rather than queued behind it.
+     */
+    for (i = 0; i < ARRAY_SIZE(sensor_registry); i++)
+    {
+        status[i] = -ETIMEDOUT;
+        if (sampler_first_of_device(i) != i)
+        {
+            continue;
+        }
+
+        rc = sensor_acq_submit(sensor_registry[i].dev, seq);
+        if (rc == 0)
+        {
+            pending++;
+        }
+        else
+        {
+            status[i] = rc;
+        }
+    }
+
+    while (pending > 0U)
+    {
+        if (sensor_acq_complete(&req, K_MSEC(CONFIG_SENSOR_ACQ_TIMEOUT_MS)) != 0)
+        {
+            break;
+        }
+
+        /* Results of a sample we gave up on earlier; taking them frees
+         * the device for the next sample.
+         */
+        if (req.tag != seq)
+        {
+            continue;
+        }
+
+        pending--;
+        sampler_counters.retries += req.retries;
+        for (i = 0; i < ARRAY_SIZE(sensor_registry); i++)
+        {
+            if (sensor_registry[i].dev == req.dev)
+            {
+                status[i] = req.status;
+                break;
+            }
+        }
+    }
+
+    /* A failed device only costs the channels it provides. Only devices
+     * whose completion for this sample was taken are read, so no worker
+     * can be fetching one underneath sensor_channel_get().
+     */
+    for (i = 0; i < ARRAY_SIZE(sensor_registry); i++)
+    {
+        rc = status[sampler_first_of_device(i)];
+        if (rc == 0)
+        {
+            rc = sensor_channel_get(sensor_registry[i].dev,
+                                    sensor_registry[i].chan,
+                                    &record->value[i]);
+        }
+
+        if (rc != 0)
+        {
+            sampler_counters.fetch_errors++;
+            if (record->status == 0)
+            {
+                record->status = rc;
+            }
+            continue;
+        }
+
+        if (sensor_registry[i].scale != 1)
+        {
+            sampler_scale(&record->value[i], sensor_registry[i].scale);
+        }
+
+#if defined(CONFIG_SENSOR_FILTER)
+        sampler_filter_value(&sampler_filter[i], &record->value[i]);
+#endif
+        record->valid |= BIT(i);
+    }
+}
+
+static void sampler_loop(void *p1, void *p2, void *p3)
+{
+    struct sample_record record;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (true)
+    {
+        k_sem_take(&sampler_tick, K_FOREVER);
+
+        /* Fetch outside the lock; only the copy into the ring is shared */
+        memset(&record, 0, sizeof(record));
+        sampler_fetch(&record, sampler_head);
+
+        k_mutex_lock(&sampler_lock, K_FOREVER);
+        record.seq = sampler_head;
+        sampler_ring[sampler_head % ARRAY_SIZE(sampler_ring)] = record;
+        sampler_head++;
+        k_condvar_broadcast(&sampler_cond);
+        k_mutex_unlock(&sampler_lock);
+
+        if (sampler_notify != NULL)
+        {
+            sampler_notify();
+        }
+    }
+}
+
+/** Start periodic sampling; the first sample is taken immediately */
+int sampler_start(void)
+{
+    if (!sensor_registry_ready())
+    {
+        return -ENODEV;
+    }
+
+    sensor_acq_start();
+
+    k_thread_create(&sampler_thread, sampler_stack,
+                    K_THREAD_STACK_SIZEOF(sampler_stack),
+                    sampler_loop, NULL, NULL, NULL,
+                    CONFIG_SAMPLER_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&sampler_thread, "sampler");
+
+    k_timer_start(&sampler_timer, K_NO_WAIT, K_MSEC(sampler_period_ms));
+
+    return 0;
+}
+
+/** Change the sampling period; the next sample is one new period away.
+ *  Periods below SAMPLER_MIN_PERIOD_MS are raised to it.
+ */
+void sampler_set_period(uint32_t period_ms)
+{
+    period_ms = MAX(period_ms, SAMPLER_MIN_PERIOD_MS);
+    if (period_ms == sampler_period_ms)
+    {
+        return;
+    }
+
+    sampler_period_ms = period_ms;
+    k_timer_start(&sampler_timer, K_MSEC(period_ms), K_MSEC(period_ms));
+}
+
+/** Have 'notify' called, from the sampler thread, after every new record;
+ *  for consumers that wait on something other than sampler_read().
+ */
+void sampler_set_notify(sampler_notify_t notify)
+{
+    sampler_notify = notify;
+}
+
+/** Snapshot of the acquisition counters */
+void sampler_stats_get(struct sampler_stats *stats)
+{
+    *stats = sampler_counters;
+}
+
+/** Attach a consumer; it will see records produced from now on */
+void sampler_reader_init(struct sampler_reader *reader)
+{
+    k_mutex_lock(&sampler_lock, K_FOREVER);
+    reader->next = sampler_head;
+    reader->overruns = 0;
+    k_mutex_unlock(&sampler_lock);
+}
+
+/** Copy out the reader's next record, waiting up to 'timeout' for one.
+ *  Returns 0, or -EAGAIN if nothing new arrived in time.
+ */
+int sampler_read(struct sampler_reader *reader, struct sample_record *record,
+                 k_timeout_t timeout)
+{
+    int rc = 0;
+
+    k_mutex_lock(&sampler_lock, K_FOREVER);
+
+    while (reader->next == sampler_head)
+    {
+        rc = k_condvar_wait(&sampler_cond, &sampler_lock, timeout);
+        if (rc != 0)
+        {
+            k_mutex_unlock(&sampler_lock);
+            return -EAGAIN;
+        }
+    }
+
+    /* A lagging reader skips ahead to the oldest record still held */
+    if ((sampler_head - reader->next) > ARRAY_SIZE(sampler_ring))
+    {
+        reader->overruns += (sampler_head - reader->next) -
+                            ARRAY_SIZE(sampler_ring);
+        reader->next = sampler_head - ARRAY_SIZE(sampler_ring);
+    }
+
+    *record = sampler_ring[reader->next % ARRAY_SIZE(sampler_ring)];
+    reader->next++;
+
+    k_mutex_unlock(&sampler_lock);
+
+    return rc;
+}
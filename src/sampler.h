@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Periodic sensor sampling decoupled from display and network.
+ *
+ * A k_timer releases a fixed-priority sampler thread every
+ * CONFIG_SAMPLER_PERIOD_MS. It fetches every sensor in the registry once
+ * and reads all registered channels. Each reading is stored, with its timestamp
+ * and which channels it holds, in a statically allocated ring. A failed
+ * sensor only takes its own channels out of the record. Any number of
+ * consumers read the ring independently through their own cursor, so a
+ * slow consumer only ever loses its own oldest records and never delays
+ * the sampling itself.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+
+#include "sensor_registry.h"
+
+#define SAMPLER_MIN_PERIOD_MS       2000  /* DHT needs 2 s between reads */
+
+/* 'valid' of a record with every channel read */
+#define SAMPLER_ALL_VALID           BIT_MASK(SENSOR_REGISTRY_COUNT)
+
+BUILD_ASSERT(SENSOR_REGISTRY_COUNT <= 32, "Channel mask is 32 bits");
+
+struct sample_record
+{
+    uint32_t seq;           /* Monotonic sample number */
+    int64_t timestamp;      /* k_uptime_get() at fetch, in ms */
+    int status;             /* 0, or the first failing sensor API return code */
+    uint32_t valid;         /* Bit c set when value[c] was read */
+    struct sensor_value value[SENSOR_REGISTRY_COUNT];  /* Registry order */
+};
+
+typedef void (*sampler_notify_t)(void);
+
+struct sampler_stats
+{
+    uint32_t fetch_errors;  /* Channel reads given up on after all retries */
+    uint32_t retries;       /* Extra fetches after a failed one */
+    uint32_t outliers;      /* Values far from their median (filtered out) */
+};
+
+struct sampler_reader
+{
+    uint32_t next;          /* Sequence number of the next record to read */
+    uint32_t overruns;      /* Records lost because this reader lagged */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int sampler_start(void);
+void sampler_set_period(uint32_t period_ms);
+void sampler_set_notify(sampler_notify_t notify);
+void sampler_stats_get(struct sampler_stats *stats);
+void sampler_reader_init(struct sampler_reader *reader);
+int sampler_read(struct sampler_reader *reader, struct sample_record *record,
+                 k_timeout_t timeout);
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sensor_acq.h"
+#include "sampler.h"
+#include "latency_stats.h"
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/pm/device_runtime.h>
+
+/* Room for one request per registered channel, even if none share a
+ * device; see sensor_acq_busy[].
+ */
+K_MSGQ_DEFINE(sensor_acq_sq, sizeof(struct sensor_acq_req),
+              SENSOR_REGISTRY_COUNT, 4);
+K_MSGQ_DEFINE(sensor_acq_cq, sizeof(struct sensor_acq_req),
+              SENSOR_REGISTRY_COUNT, 4);
+
+K_THREAD_STACK_ARRAY_DEFINE(sensor_acq_stacks, CONFIG_SENSOR_ACQ_WORKERS,
+                            CONFIG_SENSOR_ACQ_STACK_SIZE);
+
+static struct k_thread sensor_acq_threads[CONFIG_SENSOR_ACQ_WORKERS];
+
+/* Devices with a request submitted whose completion is not yet taken.
+ * One request per device at most keeps both queues from ever filling,
+ * and keeps a worker off a device while its data is being read.
+ */
+static const struct device *sensor_acq_busy[SENSOR_REGISTRY_COUNT];
+static struct k_spinlock sensor_acq_lock;
+
+/* Slot of 'dev' in sensor_acq_busy[], or of a free one for NULL */
+static int sensor_acq_find(const struct device *dev)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(sensor_acq_busy); i++)
+    {
+        if (sensor_acq_busy[i] == dev)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Sensors with runtime PM are powered only for the fetch itself; for
+ * the others get/put do nothing.
+ */
+static int sensor_acq_fetch(const struct device *dev)
+{
+    uint32_t start = latency_start();
+    int rc;
+
+    (void)pm_device_runtime_get(dev);
+    rc = sensor_sample_fetch(dev);
+    (void)pm_device_runtime_put(dev);
+
+    latency_stop(LATENCY_FETCH, start);
+
+    return rc;
+}
+
+static void sensor_acq_loop(void *p1, void *p2, void *p3)
+{
+    struct sensor_acq_req req;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (true)
+    {
+        k_msgq_get(&sensor_acq_sq, &req, K_FOREVER);
+
+        req.retries = 0;
+        req.status = sensor_acq_fetch(req.dev);
+
+        /* The DHT needs SAMPLER_MIN_PERIOD_MS between reads; retrying
+         * here sleeps only this worker.
+         */
+        while ((req.status != 0) && (req.retries < CONFIG_SAMPLER_FETCH_RETRIES))
+        {
+            req.retries++;
+            k_msleep(SAMPLER_MIN_PERIOD_MS);
+            req.status = sensor_acq_fetch(req.dev);
+        }
+
+        /* Never full: each busy device has at most one entry */
+        (void)k_msgq_put(&sensor_acq_cq, &req, K_FOREVER);
+    }
+}
+
+/** Start the worker pool */
+void sensor_acq_start(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(sensor_acq_threads); i++)
+    {
+        k_thread_create(&sensor_acq_threads[i], sensor_acq_stacks[i],
+                        K_THREAD_STACK_SIZEOF(sensor_acq_stacks[i]),
+                        sensor_acq_loop, NULL, NULL, NULL,
+                        CONFIG_SENSOR_ACQ_PRIORITY, 0, K_NO_WAIT);
+        k_thread_name_set(&sensor_acq_threads[i], "sensor_acq");
+    }
+}
+
+/** Queue a fetch of 'dev'. -EBUSY while the completion of an earlier
+ *  fetch of it has not been taken, -ENOMEM with more devices in flight
+ *  than registry channels.
+ */
+int sensor_acq_submit(const struct device *dev, uint32_t tag)
+{
+    struct sensor_acq_req req =
+    {
+        .dev = dev,
+        .tag = tag,
+    };
+    k_spinlock_key_t key = k_spin_lock(&sensor_acq_lock);
+    int slot = sensor_acq_find(dev);
+
+    if (slot >= 0)
+    {
+        k_spin_unlock(&sensor_acq_lock, key);
+        return -EBUSY;
+    }
+
+    slot = sensor_acq_find(NULL);
+    if (slot < 0)
+    {
+        k_spin_unlock(&sensor_acq_lock, key);
+        return -ENOMEM;
+    }
+
+    sensor_acq_busy[slot] = dev;
+    k_spin_unlock(&sensor_acq_lock, key);
+
+    /* Never full, for the same reason as the completion queue */
+    (void)k_msgq_put(&sensor_acq_sq, &req, K_NO_WAIT);
+
+    return 0;
+}
+
+/** Wait for the next completed fetch, in completion order; -EAGAIN on
+ *  timeout. Check 'tag' to discard results of abandoned requests. Once
+ *  taken, its device may be read and submitted again.
+ */
+int sensor_acq_complete(struct sensor_acq_req *req, k_timeout_t timeout)
+{
+    k_spinlock_key_t key;
+    int slot;
+
+    if (k_msgq_get(&sensor_acq_cq, req, timeout) != 0)
+    {
+        return -EAGAIN;
+    }
+
+    key = k_spin_lock(&sensor_acq_lock);
+    slot = sensor_acq_find(req->dev);
+    if (slot >= 0)
+    {
+        sensor_acq_busy[slot] = NULL;
+    }
+    k_spin_unlock(&sensor_acq_lock, key);
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Asynchronous sensor acquisition through submission/completion queues.
+ *
+ * sensor_sample_fetch() is synchronous, and for the DHT it bit-bangs the
+ * one-wire bus for 20 ms or more. Callers therefore post fetch requests
+ * to a submission queue, and a pool of CONFIG_SENSOR_ACQ_WORKERS
+ * preemptible worker threads executes them, retries included. Each
+ * result is posted to a completion queue. The requester blocks only on
+ * the completion queue, several sensors are fetched in parallel, and
+ * the network and display threads keep running while a slow one-wire
+ * sensor is being read. A device has at most one request in flight, from
+ * submission until its completion is taken; results of abandoned
+ * requests are never dropped, the requester skips them by 'tag'.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+struct sensor_acq_req
+{
+    const struct device *dev;
+    uint32_t tag;           /* Opaque to the workers, echoed back */
+    int status;             /* Completion: sensor_sample_fetch() result */
+    uint8_t retries;        /* Completion: extra fetches it took */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void sensor_acq_start(void);
+int sensor_acq_submit(const struct device *dev, uint32_t tag);
+int sensor_acq_complete(struct sensor_acq_req *req, k_timeout_t timeout);
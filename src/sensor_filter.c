@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sensor_filter.h"
+#include <stdlib.h>
+
+void sensor_filter_reset(struct sensor_filter *filter)
+{
+    memset(filter, 0, sizeof(*filter));
+}
+
+static int32_t sensor_filter_median(const struct sensor_filter *filter)
+{
+    int32_t sorted[CONFIG_SENSOR_FILTER_MEDIAN_N];
+    int32_t v;
+    int j;
+
+    /* Insertion sort; the window holds at most 7 values */
+    for (int i = 0; i < filter->count; i++)
+    {
+        v = filter->window[i];
+        for (j = i; (j > 0) && (sorted[j - 1] > v); j--)
+        {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+
+    return sorted[filter->count / 2];
+}
+
+/** Filter one raw value in hundredths; returns the filtered value */
+int32_t sensor_filter_apply(struct sensor_filter *filter, int32_t value,
+                            bool *outlier)
+{
+    int32_t median;
+
+    filter->window[filter->next] = value;
+    filter->next = (filter->next + 1) % ARRAY_SIZE(filter->window);
+    filter->count = MIN(filter->count + 1, ARRAY_SIZE(filter->window));
+
+    median = sensor_filter_median(filter);
+    *outlier = (llabs((int64_t)value - median) > CONFIG_SENSOR_FILTER_MAX_JUMP);
+
+    if (!filter->primed)
+    {
+        filter->ema = (int64_t)median * SENSOR_FILTER_EMA_ONE;
+        filter->primed = true;
+    }
+    else
+    {
+        filter->ema += (((int64_t)median * SENSOR_FILTER_EMA_ONE) - filter->ema) *
+                       CONFIG_SENSOR_FILTER_EMA_ALPHA / SENSOR_FILTER_EMA_ONE;
+    }
+
+    /* Round to nearest hundredth; the EMA lies between int32_t values */
+    return (int32_t)((filter->ema + ((filter->ema < 0) ?
+                      -(SENSOR_FILTER_EMA_ONE / 2) : (SENSOR_FILTER_EMA_ONE / 2))) /
+                     SENSOR_FILTER_EMA_ONE);
+}
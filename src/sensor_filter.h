@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Spike rejection and smoothing for one sensor channel.
+ *
+ * Each raw value first goes through a median of the last
+ * CONFIG_SENSOR_FILTER_MEDIAN_N values, which removes isolated spikes
+ * that still pass the DHT checksum, then through an exponential moving
+ * average with weight CONFIG_SENSOR_FILTER_EMA_ALPHA/256. A raw value
+ * further than CONFIG_SENSOR_FILTER_MAX_JUMP from the median is counted
+ * as an outlier. Cost is a sort of at most 7 integers per sample. The
+ * EMA is kept in 64 bits, so any int32_t value can be scaled and
+ * weighted without overflow.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#define SENSOR_FILTER_EMA_ONE        256  /* Alpha of 1, no smoothing */
+
+struct sensor_filter
+{
+    int32_t window[CONFIG_SENSOR_FILTER_MEDIAN_N];  /* Hundredths */
+    uint8_t count;
+    uint8_t next;
+    bool primed;                /* 'ema' holds a value */
+    int64_t ema;                /* Hundredths, 8 fraction bits */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void sensor_filter_reset(struct sensor_filter *filter);
+int32_t sensor_filter_apply(struct sensor_filter *filter, int32_t value,
+                            bool *outlier);
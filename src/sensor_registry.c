@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sensor_registry.h"
+#include <zephyr/sys/printk.h>
+
+#define SENSOR_REGISTRY_ENTRY(node)                                     \
+    {                                                                   \
+        .dev = DEVICE_DT_GET(DT_PHANDLE(node, sensor)),                 \
+        .chan = UTIL_CAT(SENSOR_CHAN_,                                  \
+                         DT_STRING_UPPER_TOKEN(node, channel)),         \
+        .name = DT_NODE_FULL_NAME(node),                                \
+        .topic = DT_PROP(node, topic),                                  \
+        .stats_topic = DT_PROP(node, topic) "/Stats",                   \
+        .qos = SENSOR_REGISTRY_QOS(node),                               \
+        .unit = DT_PROP(node, unit),                                    \
+        .scale = DT_PROP(node, scale),                                  \
+        .deadband = DT_PROP(node, deadband),                            \
+        .rel_deadband = DT_PROP(node, relative_deadband),               \
+        .roc_per_min = DT_PROP(node, rate_of_change),                   \
+    },
+
+const struct sensor_registry_channel sensor_registry[SENSOR_REGISTRY_COUNT] =
+{
+    DT_FOREACH_CHILD_STATUS_OKAY(SENSOR_REGISTRY_NODE, SENSOR_REGISTRY_ENTRY)
+};
+
+/** Check every sensor device the table refers to */
+bool sensor_registry_ready(void)
+{
+    bool ready = true;
+
+    for (size_t i = 0; i < ARRAY_SIZE(sensor_registry); i++)
+    {
+        if (!device_is_ready(sensor_registry[i].dev))
+        {
+            printk("Device %s is not ready\n", sensor_registry[i].dev->name);
+            ready = false;
+        }
+    }
+
+    return ready;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Devicetree-generated table of the channels this station reports.
+ *
+ * Every enabled child of the "nuertey,weather-channels" node becomes one
+ * const entry, in devicetree order: the sensor device, the channel to
+ * read, its topics and their QoS, unit, scale and report policy. Topics are string
+ * literals assembled by the preprocessor, so nothing is formatted at
+ * run time. Readings carry one value per entry, indexed the same way.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/sensor.h>
+
+#define SENSOR_REGISTRY_NODE  DT_COMPAT_GET_ANY_STATUS_OKAY(nuertey_weather_channels)
+
+BUILD_ASSERT(DT_NODE_EXISTS(SENSOR_REGISTRY_NODE),
+             "Board overlay needs a nuertey,weather-channels node");
+
+#define SENSOR_REGISTRY_PLUS_ONE(node) + 1
+
+/* Number of registered channels, usable in array sizes */
+#define SENSOR_REGISTRY_COUNT                                           \
+    (0 DT_FOREACH_CHILD_STATUS_OKAY(SENSOR_REGISTRY_NODE,               \
+                                    SENSOR_REGISTRY_PLUS_ONE))
+
+#define SENSOR_REGISTRY_QOS(node)                                       \
+    DT_PROP_OR(node, qos, CONFIG_MQTT_TELEMETRY_QOS)
+
+#define SENSOR_REGISTRY_PLUS_ACKED(node) + (SENSOR_REGISTRY_QOS(node) != 0)
+
+/* Number of channels published at QoS 1 or 2, usable in array sizes */
+#define SENSOR_REGISTRY_ACKED_COUNT                                     \
+    (0 DT_FOREACH_CHILD_STATUS_OKAY(SENSOR_REGISTRY_NODE,               \
+                                    SENSOR_REGISTRY_PLUS_ACKED))
+
+struct sensor_registry_channel
+{
+    const struct device *dev;
+    enum sensor_channel chan;
+    const char *name;           /* Devicetree node name */
+    char *topic;
+    char *stats_topic;          /* topic + "/Stats" */
+    uint8_t qos;                /* MQTT QoS of both topics */
+    const char *unit;
+    int32_t scale;
+    int32_t deadband;           /* Hundredths */
+    uint32_t rel_deadband;      /* Per mille */
+    int32_t roc_per_min;        /* Hundredths per minute */
+};
+
+extern const struct sensor_registry_channel
+    sensor_registry[SENSOR_REGISTRY_COUNT];
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+bool sensor_registry_ready(void);
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "store_forward.h"
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/printk.h>
+
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+
+#define STORE_FORWARD_FCB_MAGIC  0x57535346  /* "WSSF" */
+
+static struct flash_sector store_forward_sectors[CONFIG_STORE_FORWARD_FLASH_SECTORS];
+static struct fcb store_forward_fcb;
+static struct fcb_entry store_forward_drain;  /* Last entry handed out */
+static bool store_forward_fcb_ready;
+#endif
+
+/* Newest readings; older ones live in flash when it is enabled */
+static struct sample_record store_forward_ram[CONFIG_STORE_FORWARD_RAM_RECORDS];
+static uint32_t store_forward_head;     /* Next RAM slot to fill */
+static uint32_t store_forward_tail;     /* Oldest RAM slot */
+static uint32_t store_forward_lost;     /* Readings dropped on overflow */
+static uint32_t store_forward_first;    /* Queue position of the oldest */
+
+/* Copies of the above for other threads, see store_forward_stats_get() */
+static atomic_t store_forward_stats_dropped;
+static atomic_t store_forward_stats_empty = ATOMIC_INIT(1);
+
+/* Refresh the copies; called at the end of every change to the queue */
+static void store_forward_stats_update(void)
+{
+    atomic_set(&store_forward_stats_dropped, (atomic_val_t)store_forward_lost);
+    atomic_set(&store_forward_stats_empty, store_forward_is_empty());
+}
+
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+/* Advance 'loc' to the next readable flash entry. Entries written by a
+ * firmware with another channel set are stepped over; 'skipped' counts
+ * them when it is not NULL.
+ */
+static int store_forward_flash_step(struct fcb_entry *loc, uint32_t *skipped)
+{
+    while (store_forward_fcb_ready &&
+           (fcb_getnext(&store_forward_fcb, loc) == 0))
+    {
+        if (loc->fe_data_len == sizeof(struct sample_record))
+        {
+            return 0;
+        }
+
+        if (skipped != NULL)
+        {
+            (*skipped)++;
+        }
+    }
+
+    return -ENOENT;
+}
+
+/* Oldest queued flash entry, if any */
+static int store_forward_flash_next(struct fcb_entry *loc)
+{
+    *loc = store_forward_drain;
+
+    return store_forward_flash_step(loc, NULL);
+}
+
+/* Queued readings in the oldest sector, which a rotate is about to drop */
+static uint32_t store_forward_flash_oldest_count(void)
+{
+    struct fcb_entry loc = store_forward_drain;
+    uint32_t count = 0;
+
+    while ((store_forward_flash_step(&loc, NULL) == 0) &&
+           (loc.fe_sector == store_forward_fcb.f_oldest))
+    {
+        count++;
+    }
+
+    return count;
+}
+
+/* Move the oldest RAM reading into the flash circular buffer */
+static void store_forward_spill(const struct sample_record *record)
+{
+    struct fcb_entry loc;
+    int rc;
+
+    rc = fcb_append(&store_forward_fcb, sizeof(*record), &loc);
+    if (rc == -ENOSPC)
+    {
+        /* Flash full too: sacrifice the oldest sector, and with it the
+         * queue positions of the readings it still held.
+         */
+        store_forward_first += store_forward_flash_oldest_count();
+        if (store_forward_drain.fe_sector == store_forward_fcb.f_oldest)
+        {
+            store_forward_drain.fe_sector = NULL;
+        }
+        fcb_rotate(&store_forward_fcb);
+        store_forward_lost++;
+        rc = fcb_append(&store_forward_fcb, sizeof(*record), &loc);
+    }
+
+    if (rc == 0)
+    {
+        rc = flash_area_write(store_forward_fcb.fap,
+                              FCB_ENTRY_FA_DATA_OFF(loc),
+                              record, sizeof(*record));
+    }
+    if (rc == 0)
+    {
+        rc = fcb_append_finish(&store_forward_fcb, &loc);
+    }
+    if (rc != 0)
+    {
+        printk("Store-and-forward spill failed: %d\n", rc);
+        store_forward_lost++;
+    }
+}
+#endif
+
+/** Open the flash queue; readings left over from before a reboot are kept */
+int store_forward_init(void)
+{
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+    uint32_t sector_cnt = ARRAY_SIZE(store_forward_sectors);
+    int rc;
+
+    rc = flash_area_get_sectors(FLASH_AREA_ID(storage), &sector_cnt,
+                                store_forward_sectors);
+    if ((rc != 0) && (rc != -ENOMEM))
+    {
+        printk("Storage partition unavailable: %d\n", rc);
+        return rc;
+    }
+
+    store_forward_fcb.f_magic = STORE_FORWARD_FCB_MAGIC;
+    store_forward_fcb.f_sectors = store_forward_sectors;
+    store_forward_fcb.f_sector_cnt = sector_cnt;
+
+    rc = fcb_init(FLASH_AREA_ID(storage), &store_forward_fcb);
+    if (rc != 0)
+    {
+        printk("FCB init failed: %d\n", rc);
+        return rc;
+    }
+
+    store_forward_drain.fe_sector = NULL;
+    store_forward_fcb_ready = true;
+#endif
+
+    store_forward_stats_update();
+
+    return 0;
+}
+
+/** Queue a reading behind everything already waiting */
+void store_forward_put(const struct sample_record *record)
+{
+    const uint32_t size = ARRAY_SIZE(store_forward_ram);
+
+    if ((store_forward_head - store_forward_tail) == size)
+    {
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+        if (store_forward_fcb_ready)
+        {
+            store_forward_spill(&store_forward_ram[store_forward_tail % size]);
+        }
+        else
+#endif
+        {
+            /* The RAM tail is the front of the queue: it is gone */
+            store_forward_lost++;
+            store_forward_first++;
+        }
+        store_forward_tail++;
+    }
+
+    store_forward_ram[store_forward_head % size] = *record;
+    store_forward_head++;
+    store_forward_stats_update();
+}
+
+/** Queue position of the oldest waiting reading. Positions count up by
+ *  one per reading and stay with it until it leaves the queue, so a
+ *  sender can remember how far it got while earlier readings still await
+ *  acknowledgement. Readings dropped on overflow move this forward.
+ */
+uint32_t store_forward_position(void)
+{
+    return store_forward_first;
+}
+
+/** Copy up to 'max' waiting readings, oldest first, starting at queue
+ *  position 'pos', without removing them. Returns how many were copied;
+ *  0 as well when 'pos' lies before store_forward_position().
+ */
+size_t store_forward_peek_at(uint32_t pos, struct sample_record *records,
+                             size_t max)
+{
+    const uint32_t size = ARRAY_SIZE(store_forward_ram);
+    uint32_t skip = pos - store_forward_first;
+    size_t count = 0;
+    uint32_t i;
+
+    if ((int32_t)skip < 0)
+    {
+        return 0;
+    }
+
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+    struct fcb_entry loc = store_forward_drain;
+
+    while ((count < max) && (store_forward_flash_step(&loc, NULL) == 0))
+    {
+        if (skip > 0U)
+        {
+            skip--;
+            continue;
+        }
+
+        if (flash_area_read(store_forward_fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc),
+                            &records[count], sizeof(records[count])) != 0)
+        {
+            return count;
+        }
+        count++;
+    }
+#endif
+
+    for (i = store_forward_tail; (count < max) && (i != store_forward_head); i++)
+    {
+        if (skip > 0U)
+        {
+            skip--;
+            continue;
+        }
+        records[count++] = store_forward_ram[i % size];
+    }
+
+    return count;
+}
+
+/* Drop the oldest waiting reading */
+static void store_forward_pop(void)
+{
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+    struct fcb_entry loc = store_forward_drain;
+    uint32_t skipped = 0;
+
+    if (store_forward_flash_step(&loc, &skipped) == 0)
+    {
+        store_forward_drain = loc;
+        store_forward_lost += skipped;
+        store_forward_first++;
+
+        /* Reclaim the oldest sector once the drain has moved past it */
+        if ((store_forward_drain.fe_sector != store_forward_fcb.f_oldest) &&
+            (fcb_rotate(&store_forward_fcb) != 0))
+        {
+            printk("FCB rotate failed\n");
+        }
+        return;
+    }
+#endif
+
+    if (store_forward_head != store_forward_tail)
+    {
+        store_forward_tail++;
+        store_forward_first++;
+    }
+}
+
+/** Drop every reading before queue position 'end', e.g. once the broker
+ *  has acknowledged them. Readings already gone are skipped.
+ */
+void store_forward_pop_through(uint32_t end)
+{
+    while (((int32_t)(end - store_forward_first) > 0) &&
+           !store_forward_is_empty())
+    {
+        store_forward_pop();
+    }
+    store_forward_stats_update();
+}
+
+/** True when neither RAM nor flash holds a reading still to deliver */
+bool store_forward_is_empty(void)
+{
+#if defined(CONFIG_STORE_FORWARD_FLASH)
+    struct fcb_entry loc;
+
+    if (store_forward_flash_next(&loc) == 0)
+    {
+        return false;
+    }
+#endif
+
+    return store_forward_head == store_forward_tail;
+}
+
+/** Counters for other threads, e.g. the shell. The queue itself is only
+ *  safe to use from the thread that fills and drains it.
+ */
+void store_forward_stats_get(struct store_forward_stats *stats)
+{
+    stats->dropped = (uint32_t)atomic_get(&store_forward_stats_dropped);
+    stats->empty = (atomic_get(&store_forward_stats_empty) != 0);
+}
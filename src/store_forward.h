@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Store-and-forward queue for readings that could not be published.
+ *
+ * Readings are queued in a small RAM ring. When it fills up, the oldest
+ * readings spill into a flash circular buffer (FCB) on the "storage"
+ * partition, so an outage longer than the RAM ring survives without
+ * growing RAM use: only the FCB read position is kept in RAM. Readings
+ * leave the queue strictly oldest first, flash before RAM.
+ *
+ * Delivery is at-least-once: a reading leaves the queue only once the
+ * broker has acknowledged it (see store_forward_pop_through()), so one
+ * that was sent but not yet acknowledged is sent again after a reboot.
+ */
+#pragma once
+
+#include "sampler.h"
+
+/* Snapshot for other threads, see store_forward_stats_get() */
+struct store_forward_stats
+{
+    uint32_t dropped;       /* Overflow events: a reading, or a whole flash
+                             * sector of them, dropped because both RAM
+                             * and flash were full
+                             */
+    bool empty;             /* Nothing left to deliver */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int store_forward_init(void);
+void store_forward_put(const struct sample_record *record);
+uint32_t store_forward_position(void);
+size_t store_forward_peek_at(uint32_t pos, struct sample_record *records,
+                             size_t max);
+void store_forward_pop_through(uint32_t end);
+bool store_forward_is_empty(void);
+void store_forward_stats_get(struct store_forward_stats *stats);
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Trace-replaying sensor for native_posix, see the
+ * nuertey,trace-sensor binding.
+ */
+#define DT_DRV_COMPAT nuertey_trace_sensor
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/pm/device.h>
+#include <zephyr/pm/device_runtime.h>
+
+struct trace_sensor_config
+{
+    const int32_t *temperature;     /* Hundredths */
+    const int32_t *humidity;
+    size_t length;
+    uint32_t fail_every;
+    uint32_t fetch_time_ms;
+};
+
+struct trace_sensor_data
+{
+    uint32_t fetches;
+    size_t index;                   /* Entry the channels report */
+    bool suspended;
+};
+
+static void trace_sensor_centi(struct sensor_value *val, int32_t centi)
+{
+    val->val1 = centi / 100;
+    val->val2 = (centi % 100) * 10000;
+}
+
+static int trace_sensor_sample_fetch(const struct device *dev,
+                                     enum sensor_channel chan)
+{
+    const struct trace_sensor_config *cfg = dev->config;
+    struct trace_sensor_data *data = dev->data;
+
+    ARG_UNUSED(chan);
+
+    /* Catches a fetch without pm_device_runtime_get() */
+    if (data->suspended)
+    {
+        return -EBUSY;
+    }
+
+    /* Block like the real one-wire read does */
+    k_msleep(cfg->fetch_time_ms);
+
+    data->fetches++;
+    if ((cfg->fail_every != 0U) && ((data->fetches % cfg->fail_every) == 0U))
+    {
+        return -EIO;
+    }
+
+    data->index = (data->fetches - 1U) % cfg->length;
+
+    return 0;
+}
+
+static int trace_sensor_channel_get(const struct device *dev,
+                                    enum sensor_channel chan,
+                                    struct sensor_value *val)
+{
+    const struct trace_sensor_config *cfg = dev->config;
+    struct trace_sensor_data *data = dev->data;
+
+    switch (chan)
+    {
+    case SENSOR_CHAN_AMBIENT_TEMP:
+        trace_sensor_centi(val, cfg->temperature[data->index]);
+        return 0;
+
+    case SENSOR_CHAN_HUMIDITY:
+        trace_sensor_centi(val, cfg->humidity[data->index]);
+        return 0;
+
+    default:
+        return -ENOTSUP;
+    }
+}
+
+static const struct sensor_driver_api trace_sensor_api =
+{
+    .sample_fetch = trace_sensor_sample_fetch,
+    .channel_get = trace_sensor_channel_get,
+};
+
+#if defined(CONFIG_PM_DEVICE)
+static int trace_sensor_pm_action(const struct device *dev,
+                                  enum pm_device_action action)
+{
+    struct trace_sensor_data *data = dev->data;
+
+    switch (action)
+    {
+    case PM_DEVICE_ACTION_SUSPEND:
+        data->suspended = true;
+        return 0;
+
+    case PM_DEVICE_ACTION_RESUME:
+        data->suspended = false;
+        return 0;
+
+    default:
+        return -ENOTSUP;
+    }
+}
+#endif
+
+static int trace_sensor_init(const struct device *dev)
+{
+#if defined(CONFIG_PM_DEVICE_RUNTIME)
+    /* Suspended from here on, except around each fetch */
+    return pm_device_runtime_enable(dev);
+#else
+    ARG_UNUSED(dev);
+    return 0;
+#endif
+}
+
+#define TRACE_SENSOR_DEFINE(inst)                                           \
+    BUILD_ASSERT(DT_INST_PROP_LEN(inst, temperature_trace) ==               \
+                 DT_INST_PROP_LEN(inst, humidity_trace),                    \
+                 "Trace lengths differ");                                   \
+                                                                            \
+    static const int32_t trace_sensor_temperature_##inst[] =                \
+        DT_INST_PROP(inst, temperature_trace);                              \
+    static const int32_t trace_sensor_humidity_##inst[] =                   \
+        DT_INST_PROP(inst, humidity_trace);                                 \
+                                                                            \
+    static const struct trace_sensor_config trace_sensor_config_##inst =    \
+    {                                                                       \
+        .temperature = trace_sensor_temperature_##inst,                     \
+        .humidity = trace_sensor_humidity_##inst,                           \
+        .length = ARRAY_SIZE(trace_sensor_temperature_##inst),              \
+        .fail_every = DT_INST_PROP(inst, fail_every),                       \
+        .fetch_time_ms = DT_INST_PROP(inst, fetch_time_ms),                 \
+    };                                                                      \
+                                                                            \
+    static struct trace_sensor_data trace_sensor_data_##inst;               \
+                                                                            \
+    PM_DEVICE_DT_INST_DEFINE(inst, trace_sensor_pm_action);                 \
+                                                                            \
+    DEVICE_DT_INST_DEFINE(inst, trace_sensor_init,                          \
+                          PM_DEVICE_DT_INST_GET(inst),                      \
+                          &trace_sensor_data_##inst,                        \
+                          &trace_sensor_config_##inst, POST_KERNEL,         \
+                          CONFIG_SENSOR_INIT_PRIORITY, &trace_sensor_api);
+
+DT_INST_FOREACH_STATUS_OKAY(TRACE_SENSOR_DEFINE)
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "value_format.h"
+#include <stdio.h>
+
+static const uint32_t value_format_scale[VALUE_FORMAT_MAX_DIGITS + 1] =
+{
+    1000000, 100000, 10000, 1000, 100, 10, 1
+};
+
+/** Reading in hundredths, e.g. 23.45 -> 2345 */
+int32_t sensor_value_to_centi(const struct sensor_value *val)
+{
+    return (val->val1 * 100) + (val->val2 / 10000);
+}
+
+/** Print a reading as [-]whole.fraction with 'frac_digits' (0..6)
+ *  truncated decimals, like "%.Nf" but without floating point.
+ *  Returns what snprintf() returns.
+ */
+int sensor_value_format(char *buf, size_t size, const struct sensor_value *val,
+                        unsigned int frac_digits)
+{
+    int64_t micro = ((int64_t)val->val1 * 1000000) + val->val2;
+    const char *sign = "";
+    uint32_t whole;
+    uint32_t frac;
+
+    if (micro < 0)
+    {
+        sign = "-";
+        micro = -micro;
+    }
+
+    whole = micro / 1000000;
+    frac = micro % 1000000;
+
+    if (frac_digits == 0U)
+    {
+        return snprintf(buf, size, "%s%u", sign, whole);
+    }
+
+    frac_digits = MIN(frac_digits, VALUE_FORMAT_MAX_DIGITS);
+    frac /= value_format_scale[frac_digits];
+
+    return snprintf(buf, size, "%s%u.%0*u", sign, whole, frac_digits, frac);
+}
+
+/** Uptime in ms as H:MM:SS.mmm, in a static buffer (main thread only) */
+const char *now_str(uint32_t now)
+{
+    static char buf[16]; /* ...HH:MM:SS.MMM */
+    unsigned int ms = now % MSEC_PER_SEC;
+    unsigned int s;
+    unsigned int min;
+    unsigned int h;
+
+    now /= MSEC_PER_SEC;
+    s = now % 60U;
+    now /= 60U;
+    min = now % 60U;
+    now /= 60U;
+    h = now;
+
+    snprintf(buf, sizeof(buf), "%u:%02u:%02u.%03u", h, min, s, ms);
+    return buf;
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Integer-only formatting of sensor readings.
+ *
+ * Readings stay in struct sensor_value (integer part plus millionths)
+ * from the driver to the LCD, console and MQTT payloads. Nothing is
+ * converted to double, so the image builds without floating point
+ * printf support or soft-float code.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/sensor.h>
+
+#define VALUE_FORMAT_MAX_DIGITS        6  /* sensor_value has micro units */
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+int32_t sensor_value_to_centi(const struct sensor_value *val);
+int sensor_value_format(char *buf, size_t size, const struct sensor_value *val,
+                        unsigned int frac_digits);
+const char *now_str(uint32_t now);
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file "weather" shell commands: counters and latency histograms, and
+ * requests to the main loop, which are posted with app_command_post().
+ */
+#include "sampler.h"
+#include "store_forward.h"
+#include "app_event.h"
+#include "mqtt_publisher.h"
+#include <zephyr/shell/shell.h>
+
+static const char *const conn_state_names[] =
+{
+    [MQTT_CONN_DISCONNECTED] = "disconnected",
+    [MQTT_CONN_CONNECTING] = "connecting",
+    [MQTT_CONN_CONNECTED] = "connected",
+    [MQTT_CONN_BACKOFF] = "backoff",
+    [MQTT_CONN_SUSPENDED] = "suspended",
+};
+
+static int cmd_weather_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct sampler_stats sampler;
+    struct mqtt_publish_stats mqtt;
+    struct store_forward_stats queue;
+    struct latency_hist hist;
+
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    sampler_stats_get(&sampler);
+    mqtt_publish_stats_get(&mqtt);
+    store_forward_stats_get(&queue);
+
+    shell_print(shell, "sampler: fetch_errors=%u retries=%u outliers=%u",
+                sampler.fetch_errors, sampler.retries, sampler.outliers);
+    shell_print(shell, "mqtt: %s published=%u retransmits=%u dup_acks=%u "
+                "in_flight=%u", conn_state_names[mqtt_conn_state()],
+                mqtt.published, mqtt.retransmits, mqtt.dup_acks,
+                (unsigned int)mqtt_inflight_count());
+    shell_print(shell, "store_forward: dropped=%u empty=%s",
+                queue.dropped, queue.empty ? "yes" : "no");
+
+    if (!IS_ENABLED(CONFIG_LATENCY_STATS))
+    {
+        return 0;
+    }
+
+    shell_print(shell, "%-10s %8s %10s %10s %10s %10s", "stage (us)", "count",
+                "mean", "p50 <=", "p99 <=", "max");
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++)
+    {
+        latency_get(s, &hist);
+        shell_print(shell, "%-10s %8u %10u %10u %10u %10u",
+                    latency_stage_name(s), hist.count,
+                    (hist.count == 0U) ? 0U : (uint32_t)(hist.sum_us / hist.count),
+                    latency_percentile_us(&hist, 50),
+                    latency_percentile_us(&hist, 99), hist.max_us);
+    }
+
+    return 0;
+}
+
+/* Non-empty buckets of one stage, or of all of them */
+static int cmd_weather_histogram(const struct shell *shell, size_t argc,
+                                 char **argv)
+{
+    struct latency_hist hist;
+    bool found = false;
+
+    for (int s = 0; s < LATENCY_STAGE_COUNT; s++)
+    {
+        if ((argc > 1) && (strcmp(argv[1], latency_stage_name(s)) != 0))
+        {
+            continue;
+        }
+
+        found = true;
+        latency_get(s, &hist);
+        shell_print(shell, "%s: %u samples", latency_stage_name(s), hist.count);
+
+        for (uint32_t b = 0; b < LATENCY_BUCKETS; b++)
+        {
+            if (hist.bucket[b] == 0U)
+            {
+                continue;
+            }
+
+            if (b == (LATENCY_BUCKETS - 1))
+            {
+                shell_print(shell, "  >= %8lu us: %u",
+                            BIT(b - 1), hist.bucket[b]);
+            }
+            else
+            {
+                shell_print(shell, "  <  %8lu us: %u", BIT(b), hist.bucket[b]);
+            }
+        }
+    }
+
+    if (!found)
+    {
+        shell_error(shell, "Unknown stage %s", argv[1]);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int cmd_weather_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    latency_reset();
+    shell_print(shell, "Latency histograms cleared");
+
+    return 0;
+}
+
+static int weather_command(const struct shell *shell, enum app_command cmd)
+{
+    if (app_command_post(cmd) != 0)
+    {
+        shell_error(shell, "Command queue full, try again");
+        return -EBUSY;
+    }
+
+    return 0;
+}
+
+static int cmd_weather_flush(const struct shell *shell, size_t argc, char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    return weather_command(shell, APP_CMD_FLUSH);
+}
+
+static int cmd_weather_reconnect(const struct shell *shell, size_t argc,
+                                 char **argv)
+{
+    ARG_UNUSED(argc);
+    ARG_UNUSED(argv);
+
+    return weather_command(shell, APP_CMD_RECONNECT);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_weather,
+    SHELL_CMD(stats, NULL, "Counters and per-stage latency summary",
+              cmd_weather_stats),
+    SHELL_CMD_ARG(histogram, NULL,
+                  "Latency buckets [fetch|format|lcd|publish|rtt_qos1|rtt_qos2|wake]",
+                  cmd_weather_histogram, 1, 1),
+    SHELL_CMD(reset, NULL, "Clear the latency histograms", cmd_weather_reset),
+    SHELL_CMD(flush, NULL, "Publish everything queued now", cmd_weather_flush),
+    SHELL_CMD(reconnect, NULL, "Drop and remake the broker connection",
+              cmd_weather_reconnect),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(weather, &sub_weather, "Weather station commands", NULL);
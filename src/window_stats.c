@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "window_stats.h"
+#include "value_format.h"
+#include <stdio.h>
+
+void window_stats_reset(struct window_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void window_stats_add(struct window_stats *stats, int32_t value)
+{
+    int64_t x = (int64_t)value << WINDOW_STATS_FRAC_BITS;
+    int64_t delta = x - stats->mean;
+
+    if (stats->count == 0U)
+    {
+        stats->min = value;
+        stats->max = value;
+    }
+    else
+    {
+        stats->min = MIN(stats->min, value);
+        stats->max = MAX(stats->max, value);
+    }
+
+    stats->count++;
+    stats->mean += delta / (int64_t)stats->count;
+    stats->m2 += delta * (x - stats->mean);
+}
+
+/* Integer square root, floor(sqrt(n)) */
+static uint64_t window_isqrt(uint64_t n)
+{
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > n)
+    {
+        bit >>= 2;
+    }
+
+    while (bit != 0U)
+    {
+        if (n >= root + bit)
+        {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+void window_stats_summary(const struct window_stats *stats,
+                          struct window_summary *summary)
+{
+    int64_t half = (int64_t)1 << (WINDOW_STATS_FRAC_BITS - 1);
+
+    summary->count = stats->count;
+    summary->min = stats->min;
+    summary->max = stats->max;
+    summary->mean = (stats->mean + ((stats->mean < 0) ? -half : half)) >>
+                    WINDOW_STATS_FRAC_BITS;
+    summary->stddev = 0;
+
+    if (stats->count > 1U)
+    {
+        /* sqrt of a 2x-fraction variance has the single fraction */
+        uint64_t var = MAX(stats->m2, 0) / (stats->count - 1U);
+
+        summary->stddev = (window_isqrt(var) + half) >> WINDOW_STATS_FRAC_BITS;
+    }
+}
+
+static void window_centi(struct sensor_value *val, int32_t centi)
+{
+    val->val1 = centi / 100;
+    val->val2 = (centi % 100) * 10000;
+}
+
+/** JSON object with two decimals, e.g. {"n":30,"min":21.50,...} */
+int window_summary_format(char *buf, size_t size,
+                          const struct window_summary *summary)
+{
+    char field[4][16];
+    const int32_t value[4] =
+    {
+        summary->min, summary->max, summary->mean, summary->stddev
+    };
+    struct sensor_value val;
+
+    for (size_t i = 0; i < ARRAY_SIZE(field); i++)
+    {
+        window_centi(&val, value[i]);
+        sensor_value_format(field[i], sizeof(field[i]), &val, 2);
+    }
+
+    return snprintf(buf, size,
+                    "{\"n\":%u,\"min\":%s,\"max\":%s,\"mean\":%s,\"sd\":%s}",
+                    summary->count, field[0], field[1], field[2], field[3]);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Streaming min/max/mean/stddev of one channel over a window.
+ *
+ * Welford's online algorithm in fixed point: values are hundredths, the
+ * running mean is kept with WINDOW_STATS_FRAC_BITS extra fraction bits
+ * and the sum of squared deviations with twice that. Memory is O(1) per
+ * channel whatever the window length, and no floating point is used.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+
+#define WINDOW_STATS_FRAC_BITS         8
+
+/* Longest window_summary_format() object, NUL included: a ten digit
+ * count and four "-21474836.48" fields.
+ */
+#define WINDOW_SUMMARY_SIZE            96
+
+struct window_stats
+{
+    uint32_t count;
+    int32_t min;                /* Hundredths */
+    int32_t max;
+    int64_t mean;               /* Hundredths, WINDOW_STATS_FRAC_BITS fraction */
+    int64_t m2;                 /* Squared deviations, 2x fraction bits */
+};
+
+struct window_summary
+{
+    uint32_t count;
+    int32_t min;                /* All in hundredths */
+    int32_t max;
+    int32_t mean;
+    int32_t stddev;             /* Sample standard deviation, 0 if count < 2 */
+};
+
+/******************************************
+ * USER can use the APIs that follow below.
+ *****************************************/ 
+void window_stats_reset(struct window_stats *stats);
+void window_stats_add(struct window_stats *stats, int32_t value);
+void window_stats_summary(const struct window_stats *stats,
+                          struct window_summary *summary);
+int window_summary_format(char *buf, size_t size,
+                          const struct window_summary *summary);
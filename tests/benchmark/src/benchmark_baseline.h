@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Reference results of the benchmarks, in cycles per operation,
+ * per board: the board's cycle counter, or the host's time stamp counter
+ * on native_posix.
+ *
+ * To record or refresh them, run
+ *
+ *     twister -T tests/benchmark -p <board> -x CONFIG_BENCHMARK_RECORD=y
+ *
+ * and copy the "cycles_per_op" of each BENCH line in the board's
+ * handler.log here. A benchmark without an entry for the board fails.
+ */
+#pragma once
+
+#include <zephyr/kernel.h>
+
+struct benchmark_baseline
+{
+    const char *name;
+    uint32_t cycles_per_op;
+};
+
+static const struct benchmark_baseline benchmark_baselines[] =
+{
+    /* Add one block per board, such as
+     *
+     * #if defined(CONFIG_BOARD_QEMU_CORTEX_M3)
+     *     { "lcd_char", <cycles_per_op> },
+     *     ...
+     * #endif
+     */
+    { NULL, 0 }
+};
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Micro-benchmarks of the station's hot paths.
+ *
+ * Each test times one path and prints the result as one JSON object on
+ * a line of its own, prefixed with "BENCH ", e.g.
+ *
+ *     BENCH {"name":"lcd_char","board":"qemu_cortex_m3","ops":640,"cycles_per_op":<n>,"ns_per_op":<n>,"baseline":<n>,"status":"ok"}
+ *
+ * A test fails when it takes more than CONFIG_BENCHMARK_TOLERANCE_PCT
+ * more cycles per operation than its baseline for the board in
+ * benchmark_baseline.h, or when there is no baseline to compare with.
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "benchmark_baseline.h"
+#include "lcd16x2.h"
+#include "mqtt_publisher.h"
+#include "payload_codec.h"
+#include "report_policy.h"
+#include "value_format.h"
+#include "window_stats.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(CONFIG_ARCH_POSIX)
+#include <time.h>
+#endif
+
+#define BENCHMARK_BATCH                8
+
+#define BROKER_STACK_SIZE              2048
+#define BROKER_PRIORITY                K_PRIO_PREEMPT(8)
+#define BROKER_CONNECT_MS              10000
+
+static const struct device *const lcd = DEVICE_DT_GET_ONE(nuertey_lcd16x2);
+
+/* Keeps results alive so the compiler cannot drop the work */
+static volatile uint32_t benchmark_sink;
+
+/* Time spent, or a point in time */
+struct benchmark_clock
+{
+    uint64_t cycles;
+    uint64_t ns;
+};
+
+#if defined(CONFIG_ARCH_POSIX)
+/* Simulated time stands still while native_posix code runs, so count
+ * the host's time stamp counter and clock instead.
+ */
+static void benchmark_read(struct benchmark_clock *now)
+{
+    struct timespec ts;
+
+    now->cycles = __builtin_ia32_rdtsc();
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now->ns = ((uint64_t)ts.tv_sec * NSEC_PER_SEC) + (uint64_t)ts.tv_nsec;
+}
+
+/* Add the time since 'start' to 'elapsed' */
+static void benchmark_add(struct benchmark_clock *elapsed,
+                          const struct benchmark_clock *start)
+{
+    struct benchmark_clock now;
+
+    benchmark_read(&now);
+    elapsed->cycles += now.cycles - start->cycles;
+    elapsed->ns += now.ns - start->ns;
+}
+#else
+static void benchmark_read(struct benchmark_clock *now)
+{
+    now->cycles = k_cycle_get_32();
+    now->ns = 0U;
+}
+
+/* Add the time since 'start' to 'elapsed' */
+static void benchmark_add(struct benchmark_clock *elapsed,
+                          const struct benchmark_clock *start)
+{
+    uint32_t cycles = k_cycle_get_32() - (uint32_t)start->cycles;
+
+    elapsed->cycles += cycles;
+    elapsed->ns += k_cyc_to_ns_floor64(cycles);
+}
+#endif
+
+static uint32_t benchmark_baseline(const char *name)
+{
+    for (size_t i = 0; benchmark_baselines[i].name != NULL; i++)
+    {
+        if (strcmp(benchmark_baselines[i].name, name) == 0)
+        {
+            return benchmark_baselines[i].cycles_per_op;
+        }
+    }
+
+    return 0;
+}
+
+/* Print the result of a benchmark and fail it past its baseline, or
+ * without one unless CONFIG_BENCHMARK_RECORD is set.
+ */
+static void benchmark_report(const char *name, uint32_t ops,
+                             const struct benchmark_clock *elapsed)
+{
+    uint32_t cycles = (uint32_t)(elapsed->cycles / MAX(ops, 1U));
+    uint32_t ns = (uint32_t)(elapsed->ns / MAX(ops, 1U));
+    uint32_t baseline = benchmark_baseline(name);
+    bool regressed = false;
+    const char *status;
+
+    if (IS_ENABLED(CONFIG_BENCHMARK_RECORD))
+    {
+        status = "recorded";
+    }
+    else if (baseline == 0U)
+    {
+        status = "missing";
+    }
+    else if (((uint64_t)cycles * 100U) >
+             ((uint64_t)baseline * (100U + CONFIG_BENCHMARK_TOLERANCE_PCT)))
+    {
+        status = "regressed";
+        regressed = true;
+    }
+    else
+    {
+        status = "ok";
+    }
+
+    printf("BENCH {\"name\":\"%s\",\"board\":\"%s\",\"ops\":%u,"
+           "\"cycles_per_op\":%u,\"ns_per_op\":%u,\"baseline\":%u,"
+           "\"status\":\"%s\"}\n",
+           name, CONFIG_BOARD, ops, cycles, ns, baseline, status);
+
+    if (IS_ENABLED(CONFIG_BENCHMARK_RECORD))
+    {
+        return;
+    }
+
+    zassert_not_equal(baseline, 0U, "%s: no baseline for %s", name,
+                      CONFIG_BOARD);
+    zassert_false(regressed, "%s: %u cycles/op, baseline %u cycles/op", name,
+                  cycles, baseline);
+}
+
+/* A plausible reading that changes every iteration */
+static void benchmark_record(struct sample_record *record, uint32_t i)
+{
+    memset(record, 0, sizeof(*record));
+    record->seq = i;
+    record->timestamp = 1000LL * i;
+    record->valid = SAMPLER_ALL_VALID;
+    for (size_t c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+    {
+        record->value[c].val1 = 20 + (int32_t)(i % 7U);
+        record->value[c].val2 = (int32_t)((i * 37U) % 100U) * 10000;
+    }
+}
+
+/* Stands in for the broker: accept, answer CONNECT with a CONNACK, then
+ * discard everything, which at QoS 0 needs no reply.
+ */
+static void fake_broker(void *p1, void *p2, void *p3)
+{
+    static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+    struct sockaddr_in addr =
+    {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    uint8_t buf[256];
+    ssize_t len;
+    int sock;
+    int fd;
+
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if ((sock < 0) ||
+        (zsock_bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) ||
+        (zsock_listen(sock, 1) < 0))
+    {
+        printk("fake broker: socket setup failed: %d\n", errno);
+        return;
+    }
+
+    for (;;)
+    {
+        fd = zsock_accept(sock, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        /* On loopback the whole CONNECT arrives in one segment */
+        len = zsock_recv(fd, buf, sizeof(buf), 0);
+        if ((len > 0) && ((buf[0] & 0xF0U) == 0x10U))
+        {
+            zsock_send(fd, connack, sizeof(connack), 0);
+            while (zsock_recv(fd, buf, sizeof(buf), 0) > 0)
+            {
+            }
+        }
+
+        zsock_close(fd);
+    }
+}
+
+K_THREAD_DEFINE(fake_broker_id, BROKER_STACK_SIZE, fake_broker, NULL, NULL,
+                NULL, BROKER_PRIORITY, 0, 0);
+
+/* One character through pi_lcd_frame_string() and pi_lcd_commit(): two
+ * frames that differ in every cell, so every commit rewrites them all.
+ */
+ZTEST(benchmark, test_lcd_char)
+{
+    static const char *const text[2] =
+    {
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ01234",
+        "ZYXWVUTSRQPONMLKJIHGFEDCBA9876543210zyxwv",
+    };
+    char row[LCD_MAX_COLUMNS + 1];
+    uint32_t frames = MAX(CONFIG_BENCHMARK_ITERATIONS / 50U, 2U);
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+
+    zassert_true(device_is_ready(lcd), "LCD16x2 not ready");
+
+    benchmark_read(&start);
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        for (uint8_t r = 0; r < pi_lcd_rows(lcd); r++)
+        {
+            /* Shift each row so rows differ from each other as well */
+            strncpy(row, &text[f & 1U][r], pi_lcd_columns(lcd));
+            row[pi_lcd_columns(lcd)] = '\0';
+            pi_lcd_frame_string(lcd, 0, r, row);
+        }
+        pi_lcd_commit(lcd);
+    }
+    benchmark_add(&elapsed, &start);
+
+    pi_lcd_frame_clear(lcd);
+    pi_lcd_commit(lcd);
+
+    benchmark_report("lcd_char", frames * pi_lcd_columns(lcd) * pi_lcd_rows(lcd),
+                     &elapsed);
+}
+
+ZTEST(benchmark, test_now_str)
+{
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+
+    benchmark_read(&start);
+    for (uint32_t i = 0; i < CONFIG_BENCHMARK_ITERATIONS; i++)
+    {
+        benchmark_sink += (uint8_t)now_str(i * 1237U)[0];
+    }
+    benchmark_add(&elapsed, &start);
+
+    benchmark_report("now_str", CONFIG_BENCHMARK_ITERATIONS, &elapsed);
+}
+
+/* The fixed-point "%f" replacement every published value goes through */
+ZTEST(benchmark, test_format_fixed)
+{
+    struct sample_record record;
+    char buf[16];
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+
+    benchmark_record(&record, 1);
+
+    benchmark_read(&start);
+    for (uint32_t i = 0; i < CONFIG_BENCHMARK_ITERATIONS; i++)
+    {
+        record.value[0].val2 = (int32_t)i;
+        benchmark_sink += sensor_value_format(buf, sizeof(buf),
+                                              &record.value[0], 6);
+    }
+    benchmark_add(&elapsed, &start);
+
+    benchmark_report("format_fixed", CONFIG_BENCHMARK_ITERATIONS, &elapsed);
+}
+
+/* What the firmware did before value_format.c, for comparison */
+ZTEST(benchmark, test_format_float)
+{
+    struct sample_record record;
+    char buf[16];
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+
+    Z_TEST_SKIP_IFNDEF(CONFIG_CBPRINTF_FP_SUPPORT);
+    benchmark_record(&record, 1);
+
+    benchmark_read(&start);
+    for (uint32_t i = 0; i < CONFIG_BENCHMARK_ITERATIONS; i++)
+    {
+        record.value[0].val2 = (int32_t)i;
+        benchmark_sink += snprintf(buf, sizeof(buf), "%f",
+                                   sensor_value_to_double(&record.value[0]));
+    }
+    benchmark_add(&elapsed, &start);
+
+    benchmark_report("format_float", CONFIG_BENCHMARK_ITERATIONS, &elapsed);
+}
+
+/* One reading's share of encoding a BENCHMARK_BATCH batch */
+ZTEST(benchmark, test_payload_batch)
+{
+    static struct sample_record batch[BENCHMARK_BATCH];
+    static uint8_t payload[PAYLOAD_CODEC_MAX_SIZE(BENCHMARK_BATCH)];
+    uint32_t rounds = MAX(CONFIG_BENCHMARK_ITERATIONS / BENCHMARK_BATCH, 1U);
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+
+    for (uint32_t i = 0; i < ARRAY_SIZE(batch); i++)
+    {
+        benchmark_record(&batch[i], i);
+    }
+
+    benchmark_read(&start);
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        batch[0].seq = i;
+        benchmark_sink += payload_encode_batch(payload, sizeof(payload),
+                                               batch, ARRAY_SIZE(batch));
+    }
+    benchmark_add(&elapsed, &start);
+
+    benchmark_report("payload_batch", rounds * BENCHMARK_BATCH, &elapsed);
+}
+
+/* One value string through publish(): PUBLISH encoding into tx_buffer
+ * and the write to the broker socket, here over loopback. The link is
+ * brought up and kept by the connection manager, as in the station.
+ */
+ZTEST(benchmark, test_publish)
+{
+    struct sample_record record;
+    char value[16];
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+    int64_t deadline = k_uptime_get() + BROKER_CONNECT_MS;
+    int rc;
+
+    while ((mqtt_conn_state() != MQTT_CONN_CONNECTED) &&
+           (k_uptime_get() < deadline))
+    {
+        mqtt_conn_step(&client_ctx);
+        k_msleep(MAX(MIN(mqtt_conn_next_ms(&client_ctx), APP_CONNECT_POLL_MS), 1));
+    }
+    zassert_equal(mqtt_conn_state(), MQTT_CONN_CONNECTED,
+                  "No CONNACK from the fake broker");
+
+    for (uint32_t i = 0; i < CONFIG_BENCHMARK_ITERATIONS; i++)
+    {
+        benchmark_record(&record, i);
+        sensor_value_format(value, sizeof(value), &record.value[0], 6);
+
+        benchmark_read(&start);
+        rc = publish(&client_ctx, sensor_registry[0].topic,
+                     MQTT_QOS_0_AT_MOST_ONCE, value);
+        benchmark_add(&elapsed, &start);
+
+        zassert_equal(rc, 0, "publish() failed: %d", rc);
+
+        /* Whatever the main loop would do between readings */
+        mqtt_conn_step(&client_ctx);
+        zassert_equal(mqtt_conn_state(), MQTT_CONN_CONNECTED, "Link lost");
+    }
+
+    mqtt_conn_suspend(&client_ctx);
+
+    benchmark_report("publish", CONFIG_BENCHMARK_ITERATIONS, &elapsed);
+}
+
+/* What the main loop does per reading, short of the network: console
+ * line, window statistics, report decision and MQTT value strings.
+ */
+ZTEST(benchmark, test_loop)
+{
+    struct sample_record record;
+#if defined(CONFIG_REPORT_POLICY)
+    struct report_policy policy;
+#endif
+    struct window_stats window[SENSOR_REGISTRY_COUNT];
+    char line[32 * SENSOR_REGISTRY_COUNT];
+    char value[16];
+    struct benchmark_clock start;
+    struct benchmark_clock elapsed = { 0 };
+    size_t len;
+
+#if defined(CONFIG_REPORT_POLICY)
+    report_policy_init(&policy);
+#endif
+    for (size_t c = 0; c < ARRAY_SIZE(window); c++)
+    {
+        window_stats_reset(&window[c]);
+    }
+
+    for (uint32_t i = 0; i < CONFIG_BENCHMARK_ITERATIONS; i++)
+    {
+        benchmark_record(&record, i);
+
+        benchmark_read(&start);
+        len = snprintf(line, sizeof(line), "[%s]:", now_str(record.timestamp));
+        for (size_t c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+        {
+            sensor_value_format(value, sizeof(value), &record.value[c], 2);
+            len += snprintf(&line[len], sizeof(line) - len, " %s", value);
+            len = MIN(len, sizeof(line) - 1);
+            window_stats_add(&window[c], sensor_value_to_centi(&record.value[c]));
+        }
+#if defined(CONFIG_REPORT_POLICY)
+        benchmark_sink += report_policy_update(&policy, &record);
+#endif
+        for (size_t c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+        {
+            benchmark_sink += sensor_value_format(value, sizeof(value),
+                                                  &record.value[c], 6);
+        }
+        benchmark_add(&elapsed, &start);
+
+        benchmark_sink += (uint8_t)line[0];
+    }
+
+    benchmark_report("loop", CONFIG_BENCHMARK_ITERATIONS, &elapsed);
+}
+
+ZTEST_SUITE(benchmark, NULL, NULL, NULL, NULL, NULL);
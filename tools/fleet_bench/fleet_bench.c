@@ -0,0 +1,1176 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Fleet load generator: many simulated weather stations against one
+ * MQTT broker, to size the broker and compare payload and QoS modes.
+ *
+ * Each station behaves like the firmware: readings are produced on a
+ * fixed period and queued, then published either one ASCII topic per
+ * channel or as payload_codec batches. QoS 1/2 messages are pipelined
+ * through an in-flight window with retransmits, and lost connections are
+ * remade after a jittered exponential backoff. The payload encoder, value
+ * formatter and latency histograms are the firmware's own sources; only
+ * the MQTT 3.1.1 framing is redone here over non-blocking POSIX sockets,
+ * all stations sharing one poll() loop.
+ *
+ * See README.md in this directory for building and running it.
+ */
+#define _GNU_SOURCE
+
+#include "payload_codec.h"
+#include "value_format.h"
+#include "latency_stats.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* MQTT 3.1.1 control packet types, already shifted into the first byte */
+#define MQTT_CONNECT        0x10
+#define MQTT_CONNACK        0x20
+#define MQTT_PUBLISH        0x30
+#define MQTT_PUBACK         0x40
+#define MQTT_PUBREC         0x50
+#define MQTT_PUBREL         0x62    /* Reserved flags 0b0010 */
+#define MQTT_PUBCOMP        0x70
+#define MQTT_PINGREQ        0xC0
+#define MQTT_PINGRESP       0xD0
+#define MQTT_DISCONNECT     0xE0
+#define MQTT_PUBLISH_DUP    0x08
+
+#define STATION_TX_SIZE     8192    /* Unsent bytes before backpressure */
+#define STATION_RX_SIZE     256     /* Only acks come back */
+#define STATION_PACKET_SIZE 512     /* One PUBLISH, header included */
+#define CONNECT_TIMEOUT_MS  2000    /* Like APP_CONNECT_TIMEOUT_MS */
+
+enum station_state
+{
+    STATION_BACKOFF,            /* Waiting out a jittered retry delay */
+    STATION_TCP,                /* Non-blocking connect() in progress */
+    STATION_CONNACK,            /* CONNECT sent */
+    STATION_CONNECTED,
+};
+
+struct station_inflight
+{
+    uint16_t message_id;        /* 0 marks a free slot */
+    uint8_t qos;
+    bool released;              /* QoS 2: PUBREC seen, waiting for PUBCOMP */
+    int64_t sent_us;            /* First PUBLISH, for the round trip */
+    int64_t deadline_ms;        /* Retransmit once reached */
+    uint16_t len;
+    uint8_t packet[STATION_PACKET_SIZE];
+};
+
+struct station
+{
+    uint32_t id;
+    int fd;
+    enum station_state state;
+    uint32_t attempts;          /* Failed attempts since last success */
+    int64_t deadline_ms;        /* Backoff expiry or connect timeout */
+    int64_t connect_us;         /* When the TCP connect started */
+    int64_t next_sample_ms;
+    int64_t last_tx_ms;         /* For the keepalive */
+    uint32_t seq;
+    int32_t value[SENSOR_REGISTRY_COUNT];  /* Random walk, hundredths */
+    struct sample_record *queue;    /* Readings waiting for the broker */
+    size_t queued;
+    size_t channel;             /* Next channel of queue[0] to publish */
+    uint16_t last_message_id;
+    struct station_inflight *inflight;
+    uint8_t tx[STATION_TX_SIZE];
+    size_t tx_len;
+    uint8_t rx[STATION_RX_SIZE];
+    size_t rx_len;
+};
+
+/* Command line; defaults follow the firmware's Kconfig defaults */
+static struct
+{
+    const char *host;
+    uint16_t port;
+    uint32_t stations;
+    uint32_t period_ms;         /* CONFIG_SAMPLER_PERIOD_MS */
+    uint8_t qos;                /* CONFIG_MQTT_TELEMETRY_QOS */
+    uint32_t batch;             /* 1: ASCII per channel, else CONFIG_MQTT_BATCH_SIZE */
+    uint32_t window;            /* CONFIG_MQTT_INFLIGHT_MAX */
+    uint32_t queue;             /* Readings held per station while offline */
+    uint32_t retransmit_ms;     /* CONFIG_MQTT_RETRANSMIT_MS */
+    uint32_t backoff_min_ms;    /* CONFIG_MQTT_BACKOFF_MIN_MS */
+    uint32_t backoff_max_ms;    /* CONFIG_MQTT_BACKOFF_MAX_MS */
+    uint32_t ramp_ms;           /* Spread of the initial connects */
+    uint32_t keepalive_s;
+    uint32_t duration_s;
+    uint32_t storm_every_s;     /* 0: no reconnect storms */
+    uint32_t storm_percent;
+    bool no_jitter;
+    bool check;                 /* Exit status reports a healthy run */
+    int broker_pid;
+} opt =
+{
+    .host = "127.0.0.1",
+    .port = 1883,
+    .stations = 100,
+    .period_ms = 1000,
+    .qos = 1,
+    .batch = 1,
+    .window = 4,
+    .queue = 64,
+    .retransmit_ms = 5000,
+    .backoff_min_ms = 1000,
+    .backoff_max_ms = 60000,
+    .ramp_ms = 1000,
+    .keepalive_s = 60,
+    .duration_s = 30,
+    .storm_percent = 100,
+    .broker_pid = 0,
+};
+
+/* Totals and the counts of the current one-second report */
+struct fleet_counts
+{
+    uint64_t readings;
+    uint64_t sent;              /* Readings that left in a PUBLISH */
+    uint64_t publishes;
+    uint64_t payload_bytes;
+    uint64_t acks;
+    uint64_t retransmits;
+    uint64_t connects;
+    uint64_t disconnects;
+    uint64_t dropped;           /* Readings lost to a full station queue */
+};
+
+static struct fleet_counts total;
+static struct fleet_counts last;
+static struct latency_hist connect_hist;
+static struct sockaddr_in broker_addr;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000LL) + (ts.tv_nsec / 1000);
+}
+
+static int64_t now_ms(void)
+{
+    return now_us() / 1000;
+}
+
+/* Same bucketing as latency_record_us(), for histograms of our own */
+static void hist_add(struct latency_hist *hist, uint32_t us)
+{
+    hist->count++;
+    hist->sum_us += us;
+    hist->max_us = MAX(hist->max_us, us);
+    hist->bucket[MIN(find_msb_set(us), LATENCY_BUCKETS - 1)]++;
+}
+
+/* Broker CPU time in clock ticks from /proc, or -1 */
+static long long broker_cpu_ticks(void)
+{
+    char path[64];
+    char stat[1024];
+    unsigned long long utime;
+    unsigned long long stime;
+    const char *fields;
+    size_t len;
+    FILE *f;
+
+    if (opt.broker_pid <= 0)
+    {
+        return -1;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", opt.broker_pid);
+    f = fopen(path, "r");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    len = fread(stat, 1, sizeof(stat) - 1, f);
+    fclose(f);
+    stat[len] = '\0';
+
+    /* The command name may contain spaces; fields resume after its ')' */
+    fields = strrchr(stat, ')');
+    if ((fields == NULL) ||
+        (sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                &utime, &stime) != 2))
+    {
+        return -1;
+    }
+
+    return (long long)(utime + stime);
+}
+
+/*
+ * MQTT framing
+ */
+static size_t mqtt_put_length(uint8_t *buf, size_t len)
+{
+    size_t n = 0;
+
+    do
+    {
+        buf[n] = len & 0x7F;
+        len >>= 7;
+        buf[n] |= (len != 0U) ? 0x80 : 0x00;
+        n++;
+    } while (len != 0U);
+
+    return n;
+}
+
+static size_t mqtt_put_string(uint8_t *buf, const char *str)
+{
+    size_t len = strlen(str);
+
+    buf[0] = len >> 8;
+    buf[1] = len & 0xFF;
+    memcpy(&buf[2], str, len);
+
+    return 2 + len;
+}
+
+/* Queue bytes for the socket; false when the station is backed up */
+static bool station_write(struct station *st, const uint8_t *data, size_t len)
+{
+    if (len > (sizeof(st->tx) - st->tx_len))
+    {
+        return false;
+    }
+
+    memcpy(&st->tx[st->tx_len], data, len);
+    st->tx_len += len;
+    st->last_tx_ms = now_ms();
+
+    return true;
+}
+
+static void station_ack(struct station *st, uint8_t type, uint16_t message_id)
+{
+    const uint8_t packet[4] = { type, 2, message_id >> 8, message_id & 0xFF };
+
+    station_write(st, packet, sizeof(packet));
+}
+
+static void station_connect_packet(struct station *st)
+{
+    uint8_t body[64];
+    uint8_t packet[72];
+    char client_id[24];
+    size_t len = 0;
+    size_t n;
+
+    snprintf(client_id, sizeof(client_id), "fleet_%u", st->id);
+
+    len += mqtt_put_string(&body[len], "MQTT");
+    body[len++] = 4;                    /* Protocol level 3.1.1 */
+    body[len++] = 0x02;                 /* Clean session */
+    body[len++] = opt.keepalive_s >> 8;
+    body[len++] = opt.keepalive_s & 0xFF;
+    len += mqtt_put_string(&body[len], client_id);
+
+    packet[0] = MQTT_CONNECT;
+    n = 1 + mqtt_put_length(&packet[1], len);
+    memcpy(&packet[n], body, len);
+
+    station_write(st, packet, n + len);
+}
+
+/* Build a PUBLISH; returns its length, or 0 if it does not fit */
+static size_t mqtt_publish_packet(uint8_t *packet, size_t size,
+                                  const char *topic, uint8_t qos,
+                                  uint16_t message_id,
+                                  const uint8_t *payload, size_t len)
+{
+    size_t remaining = 2 + strlen(topic) + ((qos != 0U) ? 2 : 0) + len;
+    size_t n;
+
+    if ((remaining + 5) > size)
+    {
+        return 0;
+    }
+
+    packet[0] = MQTT_PUBLISH | (qos << 1);
+    n = 1 + mqtt_put_length(&packet[1], remaining);
+    n += mqtt_put_string(&packet[n], topic);
+    if (qos != 0U)
+    {
+        packet[n++] = message_id >> 8;
+        packet[n++] = message_id & 0xFF;
+    }
+    memcpy(&packet[n], payload, len);
+
+    return n + len;
+}
+
+/*
+ * Station behaviour
+ */
+static struct station_inflight *station_inflight_find(struct station *st,
+                                                      uint16_t message_id)
+{
+    for (size_t i = 0; i < opt.window; i++)
+    {
+        if ((message_id != 0U) && (st->inflight[i].message_id == message_id))
+        {
+            return &st->inflight[i];
+        }
+    }
+
+    return NULL;
+}
+
+static size_t station_inflight_count(const struct station *st)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < opt.window; i++)
+    {
+        count += (st->inflight[i].message_id != 0U);
+    }
+
+    return count;
+}
+
+/* Like message_id_next(): monotonic, never 0, never one still in flight */
+static uint16_t station_message_id(struct station *st)
+{
+    do
+    {
+        st->last_message_id++;
+    } while ((st->last_message_id == 0U) ||
+             (station_inflight_find(st, st->last_message_id) != NULL));
+
+    return st->last_message_id;
+}
+
+/* Jittered exponential backoff, as conn_backoff() in the firmware */
+static void station_backoff(struct station *st)
+{
+    uint64_t delay = opt.backoff_min_ms;
+
+    /* Double per attempt up to the maximum, as conn_backoff() does; a
+     * shift would wrap once backoff_min_ms << attempts passes 32 bits.
+     */
+    for (uint32_t i = 0; (i < st->attempts) && (delay < opt.backoff_max_ms); i++)
+    {
+        delay *= 2U;
+    }
+    delay = MIN(delay, opt.backoff_max_ms);
+    if (!opt.no_jitter)
+    {
+        delay = (delay / 2U) + ((uint32_t)random() % ((delay / 2U) + 1U));
+    }
+
+    st->attempts++;
+    st->deadline_ms = now_ms() + delay;
+    st->state = STATION_BACKOFF;
+}
+
+static void station_drop(struct station *st)
+{
+    if (st->fd >= 0)
+    {
+        close(st->fd);
+        st->fd = -1;
+    }
+    if (st->state == STATION_CONNECTED)
+    {
+        total.disconnects++;
+    }
+
+    st->tx_len = 0;
+    st->rx_len = 0;
+    station_backoff(st);
+}
+
+static void station_start_connect(struct station *st)
+{
+    int one = 1;
+    int rc;
+
+    st->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (st->fd < 0)
+    {
+        station_backoff(st);
+        return;
+    }
+
+    setsockopt(st->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(st->fd, F_SETFL, fcntl(st->fd, F_GETFL) | O_NONBLOCK);
+
+    st->connect_us = now_us();
+    st->deadline_ms = now_ms() + CONNECT_TIMEOUT_MS;
+
+    rc = connect(st->fd, (struct sockaddr *)&broker_addr, sizeof(broker_addr));
+    if ((rc == 0) || (errno == EINPROGRESS))
+    {
+        st->state = STATION_TCP;
+        return;
+    }
+
+    station_drop(st);
+}
+
+/* Next reading: a slow random walk around 22 degC and 45 %RH */
+static void station_sample(struct station *st, int64_t now)
+{
+    struct sample_record *record;
+
+    for (size_t c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+    {
+        st->value[c] += (int32_t)(random() % 21) - 10;
+    }
+
+    if (st->queued == opt.queue)
+    {
+        /* Oldest reading goes, as in a full store-and-forward queue */
+        memmove(&st->queue[0], &st->queue[1],
+                (opt.queue - 1) * sizeof(st->queue[0]));
+        st->queued--;
+        st->channel = 0;
+        total.dropped++;
+    }
+
+    record = &st->queue[st->queued++];
+    record->seq = st->seq++;
+    record->timestamp = now;
+    record->status = 0;
+    record->valid = SAMPLER_ALL_VALID;
+    for (size_t c = 0; c < SENSOR_REGISTRY_COUNT; c++)
+    {
+        record->value[c].val1 = st->value[c] / 100;
+        record->value[c].val2 = (st->value[c] % 100) * 10000;
+    }
+
+    total.readings++;
+}
+
+/* Send one message; false when the window or the socket is full */
+static bool station_publish(struct station *st, const char *topic,
+                            const uint8_t *payload, size_t len)
+{
+    struct station_inflight *slot = NULL;
+    uint8_t packet[STATION_PACKET_SIZE];
+    uint16_t message_id = 0;
+    size_t n;
+
+    if ((sizeof(st->tx) - st->tx_len) < sizeof(packet))
+    {
+        return false;
+    }
+
+    if (opt.qos != 0U)
+    {
+        for (size_t i = 0; (slot == NULL) && (i < opt.window); i++)
+        {
+            if (st->inflight[i].message_id == 0U)
+            {
+                slot = &st->inflight[i];
+            }
+        }
+        if (slot == NULL)
+        {
+            return false;
+        }
+        message_id = station_message_id(st);
+    }
+
+    n = mqtt_publish_packet(packet, sizeof(packet), topic, opt.qos,
+                            message_id, payload, len);
+    if ((n == 0U) || !station_write(st, packet, n))
+    {
+        return false;
+    }
+
+    if (slot != NULL)
+    {
+        slot->message_id = message_id;
+        slot->qos = opt.qos;
+        slot->released = false;
+        slot->sent_us = now_us();
+        slot->deadline_ms = now_ms() + opt.retransmit_ms;
+        slot->len = n;
+        memcpy(slot->packet, packet, n);
+    }
+
+    total.publishes++;
+    total.payload_bytes += len;
+
+    return true;
+}
+
+/* Publish what the firmware would: the oldest reading per channel topic,
+ * or, in batch mode, the oldest full batch.
+ */
+static void station_drain(struct station *st)
+{
+    static uint8_t payload[PAYLOAD_CODEC_MAX_SIZE(255)];
+    static const char *const names[SENSOR_REGISTRY_COUNT] =
+    {
+        "Temperature", "Humidity"
+    };
+    char topic[64];
+    char value[16];
+    size_t count;
+    int len;
+
+    while (st->queued > 0U)
+    {
+        if (opt.batch > 1U)
+        {
+            count = MIN(st->queued, opt.batch);
+            if (count < opt.batch)
+            {
+                return;     /* The firmware waits for a full batch too */
+            }
+
+            len = payload_encode_batch(payload, sizeof(payload), st->queue, count);
+            snprintf(topic, sizeof(topic), "/Nuertey/Fleet/%u/Batch", st->id);
+            if ((len < 0) || !station_publish(st, topic, payload, len))
+            {
+                return;
+            }
+        }
+        else
+        {
+            /* Every channel left of a reading needs a slot, or none is
+             * sent; after a partial send it resumes at the first channel
+             * not sent, like the firmware's publish_record().
+             */
+            count = 1;
+            if ((opt.qos != 0U) &&
+                ((station_inflight_count(st) + SENSOR_REGISTRY_COUNT - st->channel) >
+                 opt.window))
+            {
+                return;
+            }
+
+            for (; st->channel < SENSOR_REGISTRY_COUNT; st->channel++)
+            {
+                sensor_value_format(value, sizeof(value),
+                                    &st->queue[0].value[st->channel], 6);
+                snprintf(topic, sizeof(topic), "/Nuertey/Fleet/%u/%s",
+                         st->id, names[st->channel]);
+                if (!station_publish(st, topic, (const uint8_t *)value,
+                                     strlen(value)))
+                {
+                    return;     /* Socket backed up; the rest goes later */
+                }
+            }
+            st->channel = 0;
+        }
+
+        memmove(&st->queue[0], &st->queue[count],
+                (st->queued - count) * sizeof(st->queue[0]));
+        st->queued -= count;
+        total.sent += count;
+    }
+}
+
+/* Resend what is due, or everything after a reconnect */
+static void station_retransmit(struct station *st, bool all)
+{
+    int64_t now = now_ms();
+
+    for (size_t i = 0; i < opt.window; i++)
+    {
+        struct station_inflight *slot = &st->inflight[i];
+
+        if ((slot->message_id == 0U) || (!all && (now < slot->deadline_ms)))
+        {
+            continue;
+        }
+
+        if (slot->released)
+        {
+            station_ack(st, MQTT_PUBREL, slot->message_id);
+        }
+        else
+        {
+            slot->packet[0] |= MQTT_PUBLISH_DUP;
+            if (!station_write(st, slot->packet, slot->len))
+            {
+                return;
+            }
+        }
+
+        slot->deadline_ms = now + opt.retransmit_ms;
+        total.retransmits++;
+    }
+}
+
+static void station_acked(struct station *st, uint16_t message_id)
+{
+    struct station_inflight *slot = station_inflight_find(st, message_id);
+
+    if (slot == NULL)
+    {
+        return;
+    }
+
+    latency_record_us((slot->qos == 2U) ? LATENCY_RTT_QOS2 : LATENCY_RTT_QOS1,
+                      (uint32_t)MIN(now_us() - slot->sent_us, UINT32_MAX));
+    slot->message_id = 0U;
+    total.acks++;
+}
+
+/* Handle one complete packet from the broker */
+static void station_packet(struct station *st, uint8_t type,
+                           const uint8_t *body, size_t len)
+{
+    uint16_t message_id = (len >= 2U) ? (uint16_t)((body[0] << 8) | body[1]) : 0U;
+    struct station_inflight *slot;
+
+    switch (type & 0xF0)
+    {
+    case MQTT_CONNACK:
+        if ((len < 2U) || (body[1] != 0U))
+        {
+            station_drop(st);
+            return;
+        }
+
+        hist_add(&connect_hist, (uint32_t)(now_us() - st->connect_us));
+        st->state = STATION_CONNECTED;
+        st->attempts = 0;
+        total.connects++;
+        station_retransmit(st, true);
+        break;
+
+    case MQTT_PUBACK:
+    case MQTT_PUBCOMP:
+        station_acked(st, message_id);
+        break;
+
+    case MQTT_PUBREC:
+        slot = station_inflight_find(st, message_id);
+        if (slot != NULL)
+        {
+            slot->released = true;
+            slot->deadline_ms = now_ms() + opt.retransmit_ms;
+        }
+        station_ack(st, MQTT_PUBREL, message_id);
+        break;
+
+    default:
+        break;      /* PINGRESP */
+    }
+}
+
+static void station_read(struct station *st)
+{
+    ssize_t n = recv(st->fd, &st->rx[st->rx_len], sizeof(st->rx) - st->rx_len, 0);
+    size_t used = 0;
+    size_t len;
+
+    if ((n == 0) || ((n < 0) && (errno != EAGAIN)))
+    {
+        station_drop(st);
+        return;
+    }
+    if (n < 0)
+    {
+        return;
+    }
+    st->rx_len += n;
+
+    /* Acks are tiny: a one byte remaining length is all we expect */
+    while ((st->rx_len - used) >= 2U)
+    {
+        len = st->rx[used + 1];
+        if (len & 0x80)
+        {
+            station_drop(st);
+            return;
+        }
+        if ((st->rx_len - used) < (2U + len))
+        {
+            break;
+        }
+
+        station_packet(st, st->rx[used], &st->rx[used + 2], len);
+        if (st->fd < 0)
+        {
+            return;
+        }
+        used += 2U + len;
+    }
+
+    memmove(st->rx, &st->rx[used], st->rx_len - used);
+    st->rx_len -= used;
+}
+
+static void station_flush(struct station *st)
+{
+    ssize_t n;
+
+    if (st->tx_len == 0U)
+    {
+        return;
+    }
+
+    n = send(st->fd, st->tx, st->tx_len, MSG_NOSIGNAL);
+    if ((n < 0) && (errno != EAGAIN))
+    {
+        station_drop(st);
+        return;
+    }
+    if (n > 0)
+    {
+        memmove(st->tx, &st->tx[n], st->tx_len - n);
+        st->tx_len -= n;
+    }
+}
+
+/* Timers and state changes that do not need the socket to be ready */
+static void station_step(struct station *st, int64_t now)
+{
+    static const uint8_t pingreq[2] = { MQTT_PINGREQ, 0 };
+
+    while (now >= st->next_sample_ms)
+    {
+        station_sample(st, st->next_sample_ms);
+        st->next_sample_ms += opt.period_ms;
+    }
+
+    switch (st->state)
+    {
+    case STATION_BACKOFF:
+        if (now >= st->deadline_ms)
+        {
+            station_start_connect(st);
+        }
+        break;
+
+    case STATION_TCP:
+    case STATION_CONNACK:
+        if (now >= st->deadline_ms)
+        {
+            station_drop(st);
+        }
+        break;
+
+    case STATION_CONNECTED:
+        station_retransmit(st, false);
+        station_drain(st);
+        if ((opt.keepalive_s != 0U) &&
+            ((now - st->last_tx_ms) >= (opt.keepalive_s * 1000LL)))
+        {
+            station_write(st, pingreq, sizeof(pingreq));
+        }
+        break;
+    }
+}
+
+/* Abruptly close a share of the connected stations, as an outage would */
+static void fleet_storm(struct station *fleet)
+{
+    uint32_t dropped = 0;
+
+    for (uint32_t i = 0; i < opt.stations; i++)
+    {
+        if ((fleet[i].state == STATION_CONNECTED) &&
+            ((uint32_t)(random() % 100) < opt.storm_percent))
+        {
+            station_drop(&fleet[i]);
+            dropped++;
+        }
+    }
+
+    printf("# storm: dropped %u connections\n", dropped);
+}
+
+static void print_hist(const char *name, const struct latency_hist *hist)
+{
+    if (hist->count == 0U)
+    {
+        return;
+    }
+
+    printf("%-10s %10llu %10llu %10u %10u %10u %10u\n", name,
+           (unsigned long long)hist->count,
+           (unsigned long long)(hist->sum_us / hist->count),
+           latency_percentile_us(hist, 50), latency_percentile_us(hist, 90),
+           latency_percentile_us(hist, 99), hist->max_us);
+}
+
+static void report(uint32_t second, uint32_t connected, long long cpu,
+                   long long *last_cpu)
+{
+    double cpu_pct = -1.0;
+
+    if ((cpu >= 0) && (*last_cpu >= 0))
+    {
+        cpu_pct = 100.0 * (cpu - *last_cpu) / sysconf(_SC_CLK_TCK);
+    }
+    *last_cpu = cpu;
+
+    printf("%6u %9u %10llu %10llu %10llu %8llu %8llu",
+           second, connected,
+           (unsigned long long)(total.publishes - last.publishes),
+           (unsigned long long)(total.acks - last.acks),
+           (unsigned long long)(total.retransmits - last.retransmits),
+           (unsigned long long)(total.connects - last.connects),
+           (unsigned long long)(total.dropped - last.dropped));
+    if (cpu_pct >= 0.0)
+    {
+        printf(" %7.1f", cpu_pct);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    last = total;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -H host      broker address (%s)\n"
+            "  -p port      broker port (%u)\n"
+            "  -n stations  simulated stations (%u)\n"
+            "  -i ms        sampling period per station (%u)\n"
+            "  -q qos       0, 1 or 2 (%u)\n"
+            "  -b n         1: one ASCII topic per channel, else batches of n (%u)\n"
+            "  -w n         in-flight window per station (%u)\n"
+            "  -Q n         readings a station holds while offline (%u)\n"
+            "  -r ms        retransmit timeout (%u)\n"
+            "  -m ms        minimum reconnect backoff (%u)\n"
+            "  -M ms        maximum reconnect backoff (%u)\n"
+            "  -j           no backoff jitter, reconnect in lockstep\n"
+            "  -R ms        spread of the initial connects (%u)\n"
+            "  -k s         keepalive (%u)\n"
+            "  -d s         run time (%u)\n"
+            "  -s s         drop connections every s seconds (off)\n"
+            "  -S percent   share of stations a storm drops (%u)\n"
+            "  -P pid       broker process, to report its CPU use\n"
+            "  -c           exit with 2 unless every station is connected at\n"
+            "               the end, readings were published and acked, and\n"
+            "               none were dropped\n",
+            prog, opt.host, opt.port, opt.stations, opt.period_ms, opt.qos,
+            opt.batch, opt.window, opt.queue, opt.retransmit_ms,
+            opt.backoff_min_ms, opt.backoff_max_ms, opt.ramp_ms,
+            opt.keepalive_s, opt.duration_s, opt.storm_percent);
+}
+
+/* The -c verdict: false, with the reasons printed, if the run was unhealthy */
+static bool fleet_check(uint32_t connected)
+{
+    bool ok = true;
+
+    if ((opt.storm_every_s == 0U) && (connected < opt.stations))
+    {
+        printf("# check: %u of %u stations connected at the end\n",
+               connected, opt.stations);
+        ok = false;
+    }
+    if (total.sent == 0U)
+    {
+        printf("# check: no reading was published\n");
+        ok = false;
+    }
+    if ((opt.qos != 0U) && (total.acks == 0U))
+    {
+        printf("# check: no publish was acknowledged\n");
+        ok = false;
+    }
+    if (total.dropped != 0U)
+    {
+        printf("# check: %llu readings dropped\n",
+               (unsigned long long)total.dropped);
+        ok = false;
+    }
+
+    return ok;
+}
+
+static int parse_args(int argc, char **argv)
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "H:p:n:i:q:b:w:Q:r:m:M:jR:k:d:s:S:P:ch")) != -1)
+    {
+        switch (c)
+        {
+        case 'H': opt.host = optarg; break;
+        case 'p': opt.port = atoi(optarg); break;
+        case 'n': opt.stations = atoi(optarg); break;
+        case 'i': opt.period_ms = atoi(optarg); break;
+        case 'q': opt.qos = atoi(optarg); break;
+        case 'b': opt.batch = atoi(optarg); break;
+        case 'w': opt.window = atoi(optarg); break;
+        case 'Q': opt.queue = atoi(optarg); break;
+        case 'r': opt.retransmit_ms = atoi(optarg); break;
+        case 'm': opt.backoff_min_ms = atoi(optarg); break;
+        case 'M': opt.backoff_max_ms = atoi(optarg); break;
+        case 'j': opt.no_jitter = true; break;
+        case 'R': opt.ramp_ms = atoi(optarg); break;
+        case 'k': opt.keepalive_s = atoi(optarg); break;
+        case 'd': opt.duration_s = atoi(optarg); break;
+        case 's': opt.storm_every_s = atoi(optarg); break;
+        case 'S': opt.storm_percent = atoi(optarg); break;
+        case 'P': opt.broker_pid = atoi(optarg); break;
+        case 'c': opt.check = true; break;
+        default:
+            usage(argv[0]);
+            return -EINVAL;
+        }
+    }
+
+    if ((opt.stations == 0U) || (opt.period_ms == 0U) || (opt.qos > 2U) ||
+        (opt.batch == 0U) || (opt.batch > 255U) || (opt.window == 0U) ||
+        (opt.queue < opt.batch) || (opt.backoff_min_ms == 0U) ||
+        (PAYLOAD_CODEC_MAX_SIZE(opt.batch) + 64 > STATION_PACKET_SIZE))
+    {
+        fprintf(stderr, "invalid option values\n");
+        usage(argv[0]);
+        return -EINVAL;
+    }
+
+    if ((opt.qos != 0U) && (opt.batch == 1U) && (opt.window < SENSOR_REGISTRY_COUNT))
+    {
+        fprintf(stderr, "window must hold the %u topics of one reading\n",
+                (unsigned int)SENSOR_REGISTRY_COUNT);
+        return -EINVAL;
+    }
+
+    if (inet_pton(AF_INET, opt.host, &broker_addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "broker must be an IPv4 address\n");
+        return -EINVAL;
+    }
+    broker_addr.sin_family = AF_INET;
+    broker_addr.sin_port = htons(opt.port);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct rlimit nofile;
+    struct station *fleet;
+    struct pollfd *fds;
+    struct station **owner;
+    struct latency_hist rtt;
+    int64_t start;
+    int64_t now;
+    int64_t next_report;
+    int64_t next_storm;
+    int64_t end;
+    long long cpu_start;
+    long long last_cpu;
+    uint32_t second = 0;
+    uint32_t connected = 0;
+    size_t nfds;
+
+    if (parse_args(argc, argv) != 0)
+    {
+        return 1;
+    }
+
+    /* One socket per station, plus stdio */
+    if ((getrlimit(RLIMIT_NOFILE, &nofile) == 0) &&
+        (nofile.rlim_cur < (opt.stations + 16U)))
+    {
+        nofile.rlim_cur = MIN(nofile.rlim_max, (rlim_t)opt.stations + 16U);
+        setrlimit(RLIMIT_NOFILE, &nofile);
+    }
+
+    fleet = calloc(opt.stations, sizeof(*fleet));
+    fds = calloc(opt.stations, sizeof(*fds));
+    owner = calloc(opt.stations, sizeof(*owner));
+    if ((fleet == NULL) || (fds == NULL) || (owner == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    srandom(now_us());
+    start = now_ms();
+
+    for (uint32_t i = 0; i < opt.stations; i++)
+    {
+        struct station *st = &fleet[i];
+
+        st->id = i;
+        st->fd = -1;
+        st->state = STATION_BACKOFF;
+        st->deadline_ms = start + ((opt.ramp_ms == 0U) ? 0 :
+                                   (random() % opt.ramp_ms));
+        st->next_sample_ms = st->deadline_ms + (random() % opt.period_ms);
+        st->value[0] = 2200;
+        st->value[1] = 4500;
+        st->queue = calloc(opt.queue, sizeof(*st->queue));
+        st->inflight = calloc(opt.window, sizeof(*st->inflight));
+        if ((st->queue == NULL) || (st->inflight == NULL))
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("# %u stations, every %u ms, QoS %u, %s, window %u, %s%s\n",
+           opt.stations, opt.period_ms, opt.qos,
+           (opt.batch > 1U) ? "batched" : "ASCII per channel", opt.window,
+           opt.no_jitter ? "lockstep" : "jittered", " reconnects");
+    printf("%6s %9s %10s %10s %10s %8s %8s%s\n", "second", "connected",
+           "publish/s", "acks/s", "resend/s", "connects", "dropped",
+           (opt.broker_pid > 0) ? "  broker%" : "");
+
+    cpu_start = broker_cpu_ticks();
+    last_cpu = cpu_start;
+    next_report = start + 1000;
+    next_storm = (opt.storm_every_s == 0U) ? INT64_MAX :
+                 start + (opt.storm_every_s * 1000LL);
+    end = start + (opt.duration_s * 1000LL);
+
+    /* Same shape as the firmware's main loop, with one socket per station */
+    while ((now = now_ms()) < end)
+    {
+        if (now >= next_storm)
+        {
+            fleet_storm(fleet);
+            next_storm += opt.storm_every_s * 1000LL;
+        }
+
+        nfds = 0;
+        connected = 0;
+        for (uint32_t i = 0; i < opt.stations; i++)
+        {
+            struct station *st = &fleet[i];
+
+            station_step(st, now);
+            connected += (st->state == STATION_CONNECTED);
+            if (st->fd < 0)
+            {
+                continue;
+            }
+
+            fds[nfds].fd = st->fd;
+            fds[nfds].events = POLLIN;
+            if ((st->state == STATION_TCP) || (st->tx_len > 0U))
+            {
+                fds[nfds].events |= POLLOUT;
+            }
+            owner[nfds++] = st;
+        }
+
+        if (now >= next_report)
+        {
+            report(++second, connected, broker_cpu_ticks(), &last_cpu);
+            next_report += 1000;
+        }
+
+        /* Readings fall due at least every period; 10 ms keeps the
+         * per-station timers honest without spinning.
+         */
+        if (poll(fds, nfds, 10) < 0)
+        {
+            perror("poll");
+            break;
+        }
+
+        for (size_t i = 0; i < nfds; i++)
+        {
+            struct station *st = owner[i];
+
+            if (fds[i].revents == 0)
+            {
+                continue;
+            }
+
+            if (st->state == STATION_TCP)
+            {
+                int err = 0;
+                socklen_t len = sizeof(err);
+
+                getsockopt(st->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if ((err != 0) || (fds[i].revents & (POLLERR | POLLHUP)))
+                {
+                    station_drop(st);
+                    continue;
+                }
+
+                st->state = STATION_CONNACK;
+                station_connect_packet(st);
+            }
+
+            if (fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+            {
+                station_read(st);
+            }
+            if ((st->fd >= 0) && (st->tx_len > 0U))
+            {
+                station_flush(st);
+            }
+        }
+    }
+
+    /* Summary */
+    now = now_ms();
+    printf("\n# %.1f s: %llu readings, %llu publishes (%.0f/s), %llu acks, "
+           "%llu retransmits\n",
+           (now - start) / 1000.0, (unsigned long long)total.readings,
+           (unsigned long long)total.publishes,
+           total.publishes * 1000.0 / (now - start),
+           (unsigned long long)total.acks,
+           (unsigned long long)total.retransmits);
+    printf("# %llu payload bytes (%.1f per reading sent), %llu connects, "
+           "%llu disconnects, %llu readings dropped\n",
+           (unsigned long long)total.payload_bytes,
+           (total.sent == 0U) ? 0.0 :
+           (double)total.payload_bytes / total.sent,
+           (unsigned long long)total.connects,
+           (unsigned long long)total.disconnects,
+           (unsigned long long)total.dropped);
+    if ((cpu_start >= 0) && (last_cpu >= 0))
+    {
+        printf("# broker CPU %.1f%% of one core\n",
+               100.0 * (broker_cpu_ticks() - cpu_start) /
+               sysconf(_SC_CLK_TCK) / ((now - start) / 1000.0));
+    }
+
+    printf("\n%-10s %10s %10s %10s %10s %10s %10s\n", "(us)", "count", "mean",
+           "p50 <=", "p90 <=", "p99 <=", "max");
+    latency_get(LATENCY_RTT_QOS1, &rtt);
+    print_hist("ack qos1", &rtt);
+    latency_get(LATENCY_RTT_QOS2, &rtt);
+    print_hist("ack qos2", &rtt);
+    print_hist("connack", &connect_hist);
+
+    for (uint32_t i = 0; i < opt.stations; i++)
+    {
+        if (fleet[i].fd >= 0)
+        {
+            static const uint8_t disconnect[2] = { MQTT_DISCONNECT, 0 };
+
+            send(fleet[i].fd, disconnect, sizeof(disconnect), MSG_NOSIGNAL);
+            close(fleet[i].fd);
+        }
+    }
+
+    if (opt.check && !fleet_check(connected))
+    {
+        return 2;
+    }
+
+    return 0;
+}
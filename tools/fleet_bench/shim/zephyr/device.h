@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+struct device
+{
+    const char *name;
+};
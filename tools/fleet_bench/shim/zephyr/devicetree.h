@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Stands in for the generated devicetree: one weather_channels
+ * node with the temperature and humidity children of the board overlays,
+ * so SENSOR_REGISTRY_COUNT and the payload layout match the firmware.
+ */
+#pragma once
+
+#define DT_COMPAT_GET_ANY_STATUS_OKAY(compat)   fleet_channels
+#define DT_NODE_EXISTS(node)                    1
+#define DT_FOREACH_CHILD_STATUS_OKAY(node, fn)  fn(temperature) fn(humidity)
@@ -0,0 +1,20 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+
+struct sensor_value
+{
+    int32_t val1;
+    int32_t val2;
+};
+
+enum sensor_channel
+{
+    SENSOR_CHAN_AMBIENT_TEMP = 13,
+    SENSOR_CHAN_HUMIDITY = 16,
+};
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 Nuertey Odzeyem
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * @file Just enough of the Zephyr kernel API for the firmware's
+ * payload_codec.c, value_format.c and latency_stats.c to build on a
+ * POSIX host.
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#define CONFIG_LATENCY_STATS 1
+
+#define BUILD_ASSERT(expr, msg)  _Static_assert(expr, msg)
+#define ARG_UNUSED(x)            (void)(x)
+#define ARRAY_SIZE(a)            (sizeof(a) / sizeof((a)[0]))
+#define BIT(n)                   (1UL << (n))
+#define BIT_MASK(n)              (BIT(n) - 1UL)
+#define MIN(a, b)                (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)                (((a) > (b)) ? (a) : (b))
+#define MSEC_PER_SEC             1000U
+
+/* Only named in declarations the host build never calls */
+typedef struct
+{
+    int64_t ticks;
+} k_timeout_t;
+
+/* The load generator is single threaded */
+struct k_spinlock
+{
+    int unused;
+};
+
+typedef int k_spinlock_key_t;
+
+static inline k_spinlock_key_t k_spin_lock(struct k_spinlock *lock)
+{
+    ARG_UNUSED(lock);
+    return 0;
+}
+
+static inline void k_spin_unlock(struct k_spinlock *lock, k_spinlock_key_t key)
+{
+    ARG_UNUSED(lock);
+    ARG_UNUSED(key);
+}
+
+static inline unsigned int find_msb_set(uint32_t op)
+{
+    return (op == 0U) ? 0U : (32U - (unsigned int)__builtin_clz(op));
+}
+
+/* One cycle is one microsecond of CLOCK_MONOTONIC */
+static inline uint32_t k_cycle_get_32(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((ts.tv_sec * 1000000LL) + (ts.tv_nsec / 1000));
+}
+
+static inline uint32_t k_cyc_to_us_floor32(uint32_t cycles)
+{
+    return cycles;
+}
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+#
+# Copyright (c) 2022 Nuertey Odzeyem
+#
+# SPDX-License-Identifier: Apache-2.0
+#
+
+# The "mosquitto" twister fixture: start a broker on the host end of
+# zeth and on loopback, run the native_posix integration scenario
+# against it, then a short fleet_bench load against the same broker.
+# Extra arguments go to twister.
+#
+# Needs ZEPHYR_BASE, mosquitto, a C compiler and the zeth TAP interface
+# (net-setup.sh from the Zephyr net-tools repository).
+
+set -eu
+
+app=$(cd "$(dirname "$0")/../.." && pwd)
+out=${OUT:-$(mktemp -d /tmp/weather-integration.XXXXXX)}
+mkdir -p "$out"
+
+if ! ip link show zeth > /dev/null 2>&1; then
+    echo "zeth is missing; run net-setup.sh from Zephyr net-tools first" >&2
+    exit 1
+fi
+
+cat > "$out/mosquitto.conf" <<CONF
+listener 1883 192.0.2.2
+listener 1883 127.0.0.1
+allow_anonymous true
+CONF
+
+mosquitto -c "$out/mosquitto.conf" > "$out/mosquitto.log" 2>&1 &
+broker=$!
+trap 'kill $broker' EXIT
+sleep 1
+
+# The firmware: connected, publishing, acknowledged, LCD decoded
+"$ZEPHYR_BASE/scripts/twister" -T "$app" -p native_posix \
+    --fixture mosquitto --tag integration -O "$out/twister" "$@"
+
+# The fleet: every station connected, publishing and acked, ASCII at
+# QoS 1 and batched at QoS 2
+cc -std=gnu11 -O2 -Wall -I "$app/tools/fleet_bench/shim" -I "$app/src" \
+    -o "$out/fleet_bench" "$app/tools/fleet_bench/fleet_bench.c" \
+    "$app/src/payload_codec.c" "$app/src/value_format.c" \
+    "$app/src/latency_stats.c"
+"$out/fleet_bench" -n 200 -d 10 -q 1 -c -P "$broker"
+"$out/fleet_bench" -n 200 -d 10 -q 2 -b 4 -c -P "$broker"
+
+echo "Integration passed; logs in $out"